@@ -0,0 +1,16 @@
+#pragma once
+
+#include <zephyr/kernel.h>
+
+#ifdef CONFIG_NICE_VIEW_HID_FLOW_CONTROL
+
+// accounts a report of the given type against its advertised rate
+void flow_control_track(uint8_t data_type);
+
+// handles a _CAPS report from the host
+void flow_control_process(const uint8_t *data);
+
+// number of host updates the status screen has yet to redraw, called after each redraw pass
+void flow_control_backlog(uint8_t pending);
+
+#endif
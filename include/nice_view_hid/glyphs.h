@@ -0,0 +1,40 @@
+#pragma once
+
+#include <lvgl.h>
+#include <zmk/event_manager.h>
+
+#ifdef CONFIG_NICE_VIEW_HID_GLYPHS
+
+struct glyph_notification {
+    uint32_t codepoint;
+};
+
+ZMK_EVENT_DECLARE(glyph_notification);
+
+struct glyph_cache_stats {
+    // per character of host text shown, not per draw
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t bytes_used;
+};
+
+// handles a _GLYPH report from the host
+void glyph_cache_process(const uint8_t *data);
+
+// returns a font that draws like `base` but falls back to host-supplied glyphs
+const lv_font_t *glyph_font(const lv_font_t *base);
+
+void glyph_cache_get_stats(struct glyph_cache_stats *stats);
+
+// counts a hit or miss for each non-ASCII character of host text about to be shown, call from
+// the display work queue
+void glyph_cache_account(const char *text);
+
+#else
+
+static inline const lv_font_t *glyph_font(const lv_font_t *base) { return base; }
+
+static inline void glyph_cache_account(const char *text) {}
+
+#endif
@@ -4,6 +4,26 @@
 
 #ifdef CONFIG_RAW_HID
 
+#ifdef CONFIG_RAW_HID_REPORT_SIZE
+#define HID_REPORT_SIZE CONFIG_RAW_HID_REPORT_SIZE
+#else
+#define HID_REPORT_SIZE 32
+#endif
+
+// first byte of every report exchanged with the host companion
+typedef enum {
+    _TIME = 0xAA,
+    _VOLUME,
+    _LAYOUT,
+    _MEDIA_ARTIST = 0xAD,
+    _MEDIA_TITLE,
+    _IMAGE,
+    _GLYPH,
+    _METRIC,
+    _CAPS,
+    _HEARTBEAT,
+} hid_data_type;
+
 struct is_connected_notification {
     bool value;
 };
@@ -34,6 +54,20 @@ struct media_artist_notification {
 ZMK_EVENT_DECLARE(media_title_notification);
 ZMK_EVENT_DECLARE(media_artist_notification);
 
+// sends a report to the host, data is padded to the report size
+void nice_view_hid_send(const uint8_t *data, uint8_t length);
+
+struct link_stats {
+    bool is_connected;
+    uint32_t packets;
+    uint32_t timeouts;
+    uint32_t interval_ms;
+    uint32_t timeout_ms;
+};
+
+// link health of the currently selected host
+void nice_view_hid_link_stats(struct link_stats *stats);
+
 #ifdef CONFIG_NICE_VIEW_HID_SHOW_LAYOUT
 struct layout_notification {
     uint8_t value;
@@ -41,4 +75,13 @@ struct layout_notification {
 
 ZMK_EVENT_DECLARE(layout_notification);
 #endif
+
+#ifdef CONFIG_NICE_VIEW_HID_SPARKLINE
+struct metric_notification {
+    uint8_t id;
+    uint8_t value;
+};
+
+ZMK_EVENT_DECLARE(metric_notification);
+#endif
 #endif
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <zephyr/kernel.h>
+
+#ifdef CONFIG_NICE_VIEW_HID_MEM_STATS
+
+struct display_mem_stats {
+    // LVGL heap, in bytes, only known when LVGL uses its own allocator
+    bool heap_known;
+    size_t heap_size;
+    size_t heap_free;
+    size_t heap_largest_free;
+    // highest usage since boot
+    size_t heap_used_max;
+    // share of free memory not in the largest free block
+    uint8_t heap_frag_pct;
+    // display work queue thread
+    size_t stack_size;
+    size_t stack_used_max;
+};
+
+// returns the most recent sample, taken on the display work queue
+void display_mem_stats_get(struct display_mem_stats *stats);
+
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <zmk/event_manager.h>
+
+#ifdef CONFIG_NICE_VIEW_HID_PAGES
+
+// moves the status screen by step pages, 0 keeps the current one
+struct page_notification {
+    int8_t step;
+};
+
+ZMK_EVENT_DECLARE(page_notification);
+
+#endif
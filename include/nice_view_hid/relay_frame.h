@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Frames the central sends to split peripherals, carried in the two 32-bit params of a global
+// behavior. Plain C without Zephyr, so the codec can be tested on the host.
+//
+//   byte 0     header, frame kind in the high 3 bits and chunk index in the low 5 bits
+//   byte 1..7  kind specific payload
+//
+// RELAY_SCALARS carries a bitmask of changed fields followed by only those values.
+// RELAY_TITLE / RELAY_ARTIST carry the string length and one 6-byte chunk. The chunk holding
+// the terminator is always sent last so the peripheral knows when the string is complete.
+
+#define RELAY_FRAME_SIZE 8
+#define RELAY_CHUNK_SIZE 6
+#define RELAY_STR_LEN 32
+
+#define RELAY_HEADER(kind, chunk) (((kind) << 5) | ((chunk)&0x1F))
+#define RELAY_HEADER_KIND(header) ((header) >> 5)
+#define RELAY_HEADER_CHUNK(header) ((header)&0x1F)
+
+enum relay_frame_kind {
+    RELAY_SCALARS = 1,
+    RELAY_TITLE,
+    RELAY_ARTIST,
+};
+
+enum relay_scalar_field {
+    RELAY_CONNECTED = 1 << 0,
+    RELAY_TIME = 1 << 1,
+    RELAY_VOLUME = 1 << 2,
+    RELAY_LAYOUT = 1 << 3,
+};
+
+#define RELAY_ALL_SCALARS (RELAY_CONNECTED | RELAY_TIME | RELAY_VOLUME | RELAY_LAYOUT)
+
+struct relay_state {
+    bool is_connected;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t volume;
+    uint8_t layout;
+    char title[RELAY_STR_LEN];
+    char artist[RELAY_STR_LEN];
+};
+
+// scalar fields that differ between the two states
+uint8_t relay_changed_scalars(const struct relay_state *a, const struct relay_state *b);
+
+// fills a RELAY_SCALARS frame with the fields in mask
+void relay_encode_scalars(uint8_t frame[RELAY_FRAME_SIZE], const struct relay_state *state,
+                          uint8_t mask);
+
+// index of the chunk holding the terminator of str
+uint8_t relay_last_chunk(const char *str);
+
+// whether a chunk of str has to be sent to a peripheral that holds sent, the last chunk always is
+bool relay_chunk_needed(const char *str, const char *sent, uint8_t chunk);
+
+// fills a string frame with one chunk of str, which must be RELAY_STR_LEN bytes
+void relay_encode_chunk(uint8_t frame[RELAY_FRAME_SIZE], enum relay_frame_kind kind,
+                        const char *str, uint8_t chunk);
+
+// copies the fields carried by a RELAY_SCALARS frame into state and returns their mask
+uint8_t relay_decode_scalars(const uint8_t frame[RELAY_FRAME_SIZE], struct relay_state *state);
+
+// copies a string chunk into dst, which must be RELAY_STR_LEN bytes, and returns true once the
+// chunk holding the terminator arrived and dst is complete
+bool relay_decode_chunk(char *dst, const uint8_t frame[RELAY_FRAME_SIZE]);
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <lvgl.h>
+#include <zmk/event_manager.h>
+
+#ifdef CONFIG_NICE_VIEW_HID_TILES
+
+// largest image the host may push, in pixels per side
+#define TILE_MAX_SIZE 32
+
+struct image_notification {
+    bool visible;
+    uint16_t id;
+};
+
+ZMK_EVENT_DECLARE(image_notification);
+
+// handles an _IMAGE report from the host, the report is decoded later on the display work queue
+void tile_cache_process(const uint8_t *data);
+
+// returns the cached image with the given id, or NULL if it is not cached, call from the
+// display work queue
+const lv_img_dsc_t *tile_cache_get(uint16_t id);
+
+#endif
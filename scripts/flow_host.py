@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""Reference host for the keyboard's flow control.
+
+Asks for the keyboard's capabilities, then sends time, volume, media and metric updates no
+faster than the intervals in CAPS_REPLY. On CAPS_FLOW SLOW_DOWN every interval is doubled until
+FLOW_OK arrives. With --burst the first seconds ignore the advertised intervals, to check that
+the keyboard asks to slow down and clears it again once the host behaves.
+
+Requires hidapi: pip install hidapi
+"""
+
+import argparse
+import random
+import struct
+import sys
+import time
+
+from replay_storm import (MEDIA_ARTIST, MEDIA_TITLE, METRIC, REPORT_SIZE, TIME, VOLUME,
+                          open_device, report, text_report)
+
+CAPS = 0xB2
+CAPS_QUERY = 0
+CAPS_REPLY = 1
+CAPS_FLOW = 2
+FLOW_OK = 0
+FLOW_SLOW_DOWN = 1
+
+SLOW_DOWN_FACTOR = 2
+
+
+def parse_caps(data):
+    """Returns {data_type: interval_ms} from a CAPS_REPLY report."""
+    count = data[3]
+    intervals = {}
+    for i in range(count):
+        data_type, interval = struct.unpack_from("<BH", bytes(data), 4 + i * 3)
+        intervals[data_type] = interval
+    return intervals
+
+
+def updates(metric):
+    now = time.localtime()
+    return {
+        TIME: report(TIME, now.tm_hour, now.tm_min),
+        VOLUME: report(VOLUME, random.randrange(101)),
+        MEDIA_TITLE: text_report(MEDIA_TITLE, random.choice(["Title one", "Title two"])),
+        MEDIA_ARTIST: text_report(MEDIA_ARTIST, random.choice(["Artist one", "Artist two"])),
+        METRIC: report(METRIC, metric, random.randrange(101)),
+    }
+
+
+class FlowHost:
+    def __init__(self, device):
+        self.device = device
+        self.intervals = {}
+        self.slowed = False
+        self.transitions = []
+
+    def poll(self, timeout_ms):
+        data = self.device.read(REPORT_SIZE, timeout_ms)
+        if len(data) < 3 or data[0] != CAPS:
+            return
+        if data[1] == CAPS_REPLY:
+            self.intervals = parse_caps(data)
+            print(f"caps: {self.intervals}")
+        elif data[1] == CAPS_FLOW:
+            self.slowed = data[2] == FLOW_SLOW_DOWN
+            self.transitions.append((time.monotonic(), self.slowed))
+            print("flow: slow down" if self.slowed else "flow: ok")
+
+    def interval(self, data_type):
+        ms = self.intervals.get(data_type, 0)
+        return ms * (SLOW_DOWN_FACTOR if self.slowed else 1) / 1000
+
+    def run(self, duration, burst, metric):
+        self.device.write(report(CAPS, CAPS_QUERY))
+        start = time.monotonic()
+        while not self.intervals and time.monotonic() - start < 2:
+            self.poll(100)
+        if not self.intervals:
+            sys.exit("no CAPS_REPLY, is CONFIG_NICE_VIEW_HID_FLOW_CONTROL enabled?")
+
+        last_sent = {}
+        start = time.monotonic()
+        while time.monotonic() - start < duration:
+            now = time.monotonic()
+            bursting = now - start < burst
+            for data_type, data in updates(metric).items():
+                due = last_sent.get(data_type, 0) + (0 if bursting else self.interval(data_type))
+                if data_type in self.intervals and now >= due:
+                    self.device.write(data)
+                    last_sent[data_type] = now
+            self.poll(5 if bursting else 20)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--vid", type=lambda v: int(v, 0), default=0x1D50)
+    parser.add_argument("--pid", type=lambda v: int(v, 0), default=0x615E)
+    parser.add_argument("--duration", type=float, default=30, help="seconds")
+    parser.add_argument("--burst", type=float, default=0,
+                        help="seconds to ignore the advertised intervals at the start")
+    parser.add_argument("--metric", type=int, default=0, help="metric id to send")
+    args = parser.parse_args()
+
+    host = FlowHost(open_device(args.vid, args.pid))
+    try:
+        host.run(args.duration, args.burst, args.metric)
+    finally:
+        host.device.close()
+
+    if args.burst > 0:
+        if not any(slowed for _, slowed in host.transitions):
+            sys.exit("burst never triggered SLOW_DOWN")
+        if host.slowed:
+            sys.exit("still slowed down at the end, FLOW_OK never arrived")
+        print("flow control: SLOW_DOWN during the burst, FLOW_OK after it")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+"""Compares firmware size between two revisions of this module.
+
+Builds every entry of build.yaml (or those whose shield matches --only) against a ZMK checkout
+for both revisions, and prints text, data and bss of zephyr.elf with the difference. Needs a
+working west workspace with ZMK and the Zephyr SDK, the same setup as a local ZMK build.
+
+  scripts/footprint.py --zmk ~/zmk HEAD~1 HEAD --only corne_right
+
+Later -D arguments win, so --before-extra can also swap the baseline, e.g. build the stock
+nice!view screen with --before-extra=-DSHIELD="corne_right nice_view_adapter nice_view".
+"""
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+import yaml
+
+REPO = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+def build_entries(only):
+    with open(os.path.join(REPO, "build.yaml")) as f:
+        config = yaml.safe_load(f)
+
+    for entry in config.get("include", []):
+        if only is None or only in entry.get("shield", ""):
+            yield entry
+
+
+def size_tool():
+    if "SIZE" in os.environ:
+        return os.environ["SIZE"]
+    sdk = os.environ.get("ZEPHYR_SDK_INSTALL_DIR")
+    if sdk:
+        return os.path.join(sdk, "arm-zephyr-eabi", "bin", "arm-zephyr-eabi-size")
+    return shutil.which("arm-zephyr-eabi-size") or "arm-none-eabi-size"
+
+
+def build(zmk, module, entry, build_dir, extra):
+    cmd = [
+        "west", "build", "-p", "-b", entry["board"], "-d", build_dir, "-s",
+        os.path.join(zmk, "app"), "--",
+        f"-DSHIELD={entry.get('shield', '')}",
+        f"-DZMK_EXTRA_MODULES={module}",
+    ]
+    cmd += entry.get("cmake-args", "").split() + extra
+    subprocess.run(cmd, cwd=zmk, check=True, stdout=subprocess.DEVNULL)
+
+    out = subprocess.run([size_tool(), os.path.join(build_dir, "zephyr", "zephyr.elf")],
+                         check=True, capture_output=True, text=True).stdout
+    text, data, bss = (int(v) for v in out.splitlines()[1].split()[:3])
+    return {"text": text, "data": data, "bss": bss}
+
+
+def checkout(rev, into):
+    subprocess.run(["git", "-C", REPO, "worktree", "add", "--detach", into, rev], check=True,
+                   stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--zmk", required=True, help="ZMK checkout inside a west workspace")
+    parser.add_argument("--only", help="only build entries whose shield contains this")
+    parser.add_argument("--extra", action="append", default=[], help="extra cmake argument")
+    parser.add_argument("--before-extra", action="append", default=[],
+                        help="extra cmake argument for the first revision only")
+    parser.add_argument("before")
+    parser.add_argument("after")
+    args = parser.parse_args()
+
+    entries = list(build_entries(args.only))
+    if not entries:
+        sys.exit("no build.yaml entry matches")
+
+    with tempfile.TemporaryDirectory() as tmp:
+        sizes = {}
+        try:
+            for rev in (args.before, args.after):
+                module = os.path.join(tmp, f"module-{rev.replace('/', '_')}")
+                checkout(rev, module)
+                for i, entry in enumerate(entries):
+                    build_dir = os.path.join(tmp, f"build-{i}")
+                    extra = args.extra + (args.before_extra if rev == args.before else [])
+                    sizes[rev, i] = build(args.zmk, module, entry, build_dir, extra)
+        finally:
+            subprocess.run(["git", "-C", REPO, "worktree", "prune"], check=False)
+
+    print(f"{'build':48} {'section':8} {args.before:>10} {args.after:>10} {'delta':>8}")
+    for i, entry in enumerate(entries):
+        for section in ("text", "data", "bss"):
+            before = sizes[args.before, i][section]
+            after = sizes[args.after, i][section]
+            name = entry.get("artifact-name", entry.get("shield", entry["board"]))
+            print(f"{name:48} {section:8} {before:>10} {after:>10} {after - before:>+8}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""Floods the keyboard with host reports to measure status screen latency.
+
+Sends time, volume, media and metric reports over raw HID as fast as requested. Build the
+firmware with debug logging over USB (CONFIG_ZMK_USB_LOGGING=y) and change layers or profiles
+while the storm runs. The display logs the worst delay between a keyboard state change and
+its redraw as "keyboard state update latency max <n> ms".
+
+Requires hidapi: pip install hidapi
+"""
+
+import argparse
+import random
+import sys
+import time
+
+import hid
+
+VENDOR_ID = 0x1D50
+PRODUCT_ID = 0x615E
+USAGE_PAGE = 0xFF60
+USAGE = 0x61
+REPORT_SIZE = 32
+
+TIME = 0xAA
+VOLUME = 0xAB
+MEDIA_ARTIST = 0xAD
+MEDIA_TITLE = 0xAE
+METRIC = 0xB1
+
+TITLES = ["Song for a storm", "Another title", "Yet another title, a long one"]
+ARTISTS = ["Some band", "Another band"]
+
+
+def report(*data):
+    # leading zero is the report id hidapi expects
+    return bytes([0, *data]).ljust(REPORT_SIZE + 1, b"\0")
+
+
+def text_report(data_type, text):
+    encoded = text.encode("utf-8")[: REPORT_SIZE - 2]
+    return report(data_type, len(encoded), *encoded)
+
+
+def open_device(vendor_id, product_id):
+    for info in hid.enumerate(vendor_id, product_id):
+        if info["usage_page"] == USAGE_PAGE and info["usage"] == USAGE:
+            device = hid.device()
+            device.open_path(info["path"])
+            return device
+    sys.exit(f"no raw HID interface found for {vendor_id:04x}:{product_id:04x}")
+
+
+def storm(device, rate, duration, metric):
+    sent = 0
+    start = time.monotonic()
+    while time.monotonic() - start < duration:
+        now = time.localtime()
+        device.write(report(TIME, now.tm_hour, now.tm_min))
+        device.write(report(VOLUME, random.randrange(101)))
+        device.write(text_report(MEDIA_TITLE, random.choice(TITLES)))
+        device.write(text_report(MEDIA_ARTIST, random.choice(ARTISTS)))
+        device.write(report(METRIC, metric, random.randrange(101)))
+        sent += 5
+
+        # paced per round, so a slow write lowers the rate instead of bursting afterwards
+        time.sleep(max(0.0, start + sent / rate - time.monotonic()))
+
+    return sent, time.monotonic() - start
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--vid", type=lambda v: int(v, 0), default=VENDOR_ID)
+    parser.add_argument("--pid", type=lambda v: int(v, 0), default=PRODUCT_ID)
+    parser.add_argument("--rate", type=float, default=200, help="reports per second")
+    parser.add_argument("--duration", type=float, default=30, help="seconds")
+    parser.add_argument("--metric", type=int, default=0, help="metric id to send")
+    args = parser.parse_args()
+
+    device = open_device(args.vid, args.pid)
+    try:
+        sent, elapsed = storm(device, args.rate, args.duration, args.metric)
+    finally:
+        device.close()
+
+    print(f"sent {sent} reports in {elapsed:.1f} s ({sent / elapsed:.0f}/s)")
+
+
+if __name__ == "__main__":
+    main()
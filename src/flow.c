@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2023 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <nice_view_hid/hid.h>
+#include <nice_view_hid/flow.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <zmk/event_manager.h>
+#include <zmk/activity.h>
+#include <zmk/events/activity_state_changed.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+// _CAPS reports:
+//
+//   from host: [_CAPS, CAPS_QUERY]
+//   to host:   [_CAPS, CAPS_REPLY, version, count, {data_type, interval_lo, interval_hi} x count]
+//   to host:   [_CAPS, CAPS_FLOW, FLOW_OK | FLOW_SLOW_DOWN]
+//
+// CAPS_REPLY lists the shortest useful interval in milliseconds for each data type. It is sent
+// on request, when the host connects and when the keyboard goes idle or becomes active, since
+// intervals are stretched while idle. CAPS_FLOW is sent when the host keeps sending faster
+// than advertised or the screen falls behind redrawing, and again once both have recovered.
+// Recovery is checked on a timer, so FLOW_OK also goes out after the host has gone quiet.
+enum caps_op {
+    CAPS_QUERY = 0,
+    CAPS_REPLY,
+    CAPS_FLOW,
+};
+
+enum flow_state {
+    FLOW_OK = 0,
+    FLOW_SLOW_DOWN,
+};
+
+#define CAPS_VERSION 1
+#define CAPS_REPLY_HEADER_SIZE 4
+#define CAPS_REPLY_ENTRY_SIZE 3
+
+// every early report adds one to the bucket, which drains by one every FLOW_LEAK_MS
+#define FLOW_LEAK_MS 250
+#define FLOW_HIGH_WATER 8
+// host categories still waiting for a redraw on the status screen, for at least FLOW_BACKLOG_MS.
+// A connecting host sends several categories at once, which drain within a few redraws.
+#define FLOW_BACKLOG_HIGH 3
+#define FLOW_BACKLOG_MS 1000
+
+struct rate_limit {
+    uint8_t data_type;
+    uint16_t interval_ms;
+};
+
+static const struct rate_limit rate_limits[] = {
+    {_TIME, 10000},
+    {_VOLUME, 150},
+#ifdef CONFIG_NICE_VIEW_HID_SHOW_LAYOUT
+    {_LAYOUT, 100},
+#endif
+    {_MEDIA_ARTIST, 500},
+    {_MEDIA_TITLE, 500},
+#ifdef CONFIG_NICE_VIEW_HID_SPARKLINE
+    {_METRIC, 1000},
+#endif
+};
+
+static int64_t last_seen[ARRAY_SIZE(rate_limits)];
+static int64_t last_leak;
+static uint8_t bucket;
+static bool slowing_down;
+static bool idle;
+static uint8_t backlog;
+// when the backlog last reached FLOW_BACKLOG_HIGH, 0 while it is below
+static int64_t backlog_since;
+// reports are tracked on the HID thread, the drain check runs on the system work queue
+static struct k_spinlock flow_lock;
+
+static void flow_check(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(flow_check_work, flow_check);
+
+static uint16_t advertised_interval(const struct rate_limit *limit) {
+    uint32_t interval = limit->interval_ms * (idle ? CONFIG_NICE_VIEW_HID_FLOW_IDLE_FACTOR : 1);
+    return MIN(interval, UINT16_MAX);
+}
+
+static void send_caps(void) {
+    uint8_t report[HID_REPORT_SIZE] = {_CAPS, CAPS_REPLY, CAPS_VERSION};
+    uint8_t count = 0;
+
+    for (int i = 0; i < ARRAY_SIZE(rate_limits); i++) {
+        uint8_t *entry = &report[CAPS_REPLY_HEADER_SIZE + count * CAPS_REPLY_ENTRY_SIZE];
+        if (entry + CAPS_REPLY_ENTRY_SIZE > report + sizeof(report)) {
+            break;
+        }
+
+        entry[0] = rate_limits[i].data_type;
+        sys_put_le16(advertised_interval(&rate_limits[i]), &entry[1]);
+        count++;
+    }
+
+    report[3] = count;
+    nice_view_hid_send(report, sizeof(report));
+}
+
+static void send_flow(enum flow_state state) {
+    LOG_INF("flow control: %s", state == FLOW_OK ? "ok" : "slow down");
+    uint8_t report[] = {_CAPS, CAPS_FLOW, state};
+    nice_view_hid_send(report, sizeof(report));
+}
+
+// call with flow_lock held
+static void flow_leak(int64_t now) {
+    uint8_t leaked = MIN((now - last_leak) / FLOW_LEAK_MS, bucket);
+    if (leaked > 0 || bucket == 0) {
+        bucket -= leaked;
+        last_leak = now;
+    }
+}
+
+static void flow_check(struct k_work *work) {
+    int64_t now = k_uptime_get();
+
+    k_spinlock_key_t key = k_spin_lock(&flow_lock);
+    flow_leak(now);
+
+    bool behind = backlog_since != 0 && now - backlog_since >= FLOW_BACKLOG_MS;
+    bool changed = false;
+    if (!slowing_down && (bucket >= FLOW_HIGH_WATER || behind)) {
+        slowing_down = changed = true;
+    } else if (slowing_down && bucket == 0 && backlog == 0) {
+        slowing_down = false;
+        changed = true;
+    }
+    bool recovering = slowing_down;
+    int64_t backlog_due = backlog_since != 0 ? backlog_since + FLOW_BACKLOG_MS - now : 0;
+    k_spin_unlock(&flow_lock, key);
+
+    if (changed) {
+        send_flow(recovering ? FLOW_SLOW_DOWN : FLOW_OK);
+    }
+    if (recovering) {
+        k_work_schedule(&flow_check_work, K_MSEC(FLOW_LEAK_MS));
+    } else if (backlog_due > 0) {
+        // ran early for the bucket, the backlog window is still open
+        k_work_schedule(&flow_check_work, K_MSEC(backlog_due));
+    }
+}
+
+void flow_control_track(uint8_t data_type) {
+    int64_t now = k_uptime_get();
+    bool full;
+
+    k_spinlock_key_t key = k_spin_lock(&flow_lock);
+    flow_leak(now);
+
+    for (int i = 0; i < ARRAY_SIZE(rate_limits); i++) {
+        if (rate_limits[i].data_type != data_type) {
+            continue;
+        }
+        if (last_seen[i] != 0 && now - last_seen[i] < advertised_interval(&rate_limits[i])) {
+            bucket = MIN(bucket + 1, UINT8_MAX);
+        }
+        last_seen[i] = now;
+        break;
+    }
+
+    full = !slowing_down && bucket >= FLOW_HIGH_WATER;
+    k_spin_unlock(&flow_lock, key);
+
+    if (full) {
+        k_work_reschedule(&flow_check_work, K_NO_WAIT);
+    }
+}
+
+void flow_control_backlog(uint8_t pending) {
+    int64_t now = k_uptime_get();
+    bool started = false;
+
+    k_spinlock_key_t key = k_spin_lock(&flow_lock);
+    backlog = pending;
+    if (pending < FLOW_BACKLOG_HIGH) {
+        backlog_since = 0;
+    } else if (backlog_since == 0) {
+        backlog_since = now;
+        started = true;
+    }
+    k_spin_unlock(&flow_lock, key);
+
+    // checked again once the window has passed, by then the backlog may have drained
+    if (started) {
+        k_work_schedule(&flow_check_work, K_MSEC(FLOW_BACKLOG_MS));
+    }
+}
+
+void flow_control_process(const uint8_t *data) {
+    if (data[1] == CAPS_QUERY) {
+        send_caps();
+    }
+}
+
+static int flow_event_listener(const zmk_event_t *eh) {
+    const struct is_connected_notification *conn = as_is_connected_notification(eh);
+    if (conn) {
+        if (conn->value) {
+            send_caps();
+        } else {
+            k_work_cancel_delayable(&flow_check_work);
+
+            k_spinlock_key_t key = k_spin_lock(&flow_lock);
+            bucket = 0;
+            slowing_down = false;
+            memset(last_seen, 0, sizeof(last_seen));
+            k_spin_unlock(&flow_lock, key);
+        }
+        return ZMK_EV_EVENT_BUBBLE;
+    }
+
+    const struct zmk_activity_state_changed *activity = as_zmk_activity_state_changed(eh);
+    if (activity) {
+        bool was_idle = idle;
+        idle = activity->state != ZMK_ACTIVITY_ACTIVE;
+        if (idle != was_idle) {
+            send_caps();
+        }
+    }
+
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(nice_view_hid_flow, flow_event_listener);
+ZMK_SUBSCRIPTION(nice_view_hid_flow, is_connected_notification);
+ZMK_SUBSCRIPTION(nice_view_hid_flow, zmk_activity_state_changed);
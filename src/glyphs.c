@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2023 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <nice_view_hid/hid.h>
+#include <nice_view_hid/glyphs.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <zmk/display.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+ZMK_EVENT_IMPL(glyph_notification);
+
+// _GLYPH reports:
+//
+//   to host:   [_GLYPH, GLYPH_MISSING, count, {line_height, cp0, cp1, cp2} x count]
+//   from host: [_GLYPH, GLYPH_DATA, line_height, cp0, cp1, cp2, box_w, box_h, ofs_x, ofs_y,
+//               adv_w, offset, bitmap...]
+//
+// Glyphs are identified by codepoint and the line height of the font they are drawn with.
+// Bitmaps are 1-bpp, packed without row padding as LVGL expects, and may be split across
+// several reports using the byte offset. Chunks have to arrive in order, starting at 0.
+//
+// LVGL reads the cache while drawing on the display work queue, so reports are handed over
+// through a message queue and the cache is only ever touched on that queue.
+enum glyph_op {
+    GLYPH_MISSING = 0,
+    GLYPH_DATA,
+};
+
+#define GLYPH_DATA_HEADER_SIZE 12
+#define GLYPH_MISSING_HEADER_SIZE 3
+#define GLYPH_MISSING_ENTRY_SIZE 4
+#define GLYPH_MAX_SIZE 24
+#define GLYPH_BITMAP_SIZE ((GLYPH_MAX_SIZE * GLYPH_MAX_SIZE + 7) / 8)
+#define GLYPH_MISSING_COUNT 8
+#define GLYPH_REPORT_QUEUE 4
+// a partly received glyph the host stopped sending may be reused after this long
+#define GLYPH_STALE_MS 2000
+
+struct glyph {
+    uint32_t codepoint;
+    uint8_t line_height;
+    bool valid;
+    uint8_t received;
+    uint32_t last_used;
+    int64_t last_chunk;
+    lv_font_glyph_dsc_t dsc;
+    uint8_t bitmap[GLYPH_BITMAP_SIZE];
+};
+
+struct missing_glyph {
+    uint32_t codepoint;
+    uint8_t line_height;
+    bool sent;
+};
+
+static struct glyph glyphs[CONFIG_NICE_VIEW_HID_GLYPH_CACHE_SIZE];
+static struct missing_glyph missing[GLYPH_MISSING_COUNT];
+static uint32_t use_counter;
+static struct glyph_cache_stats stats;
+
+K_MSGQ_DEFINE(glyph_reports, HID_REPORT_SIZE, GLYPH_REPORT_QUEUE, 4);
+// a report didn't fit in the queue, so its glyph has to be requested again
+static atomic_t reports_dropped;
+// the host went away, forget what was requested from it
+static atomic_t missing_reset;
+
+static void glyph_work_cb(struct k_work *work);
+
+static K_WORK_DEFINE(glyph_work, glyph_work_cb);
+
+static void glyph_work_submit(void) { k_work_submit_to_queue(zmk_display_work_q(), &glyph_work); }
+
+static size_t glyph_bitmap_size(const lv_font_glyph_dsc_t *dsc) {
+    return (dsc->box_w * dsc->box_h + 7) / 8;
+}
+
+static struct glyph *glyph_find(uint32_t codepoint, uint8_t line_height) {
+    for (int i = 0; i < ARRAY_SIZE(glyphs); i++) {
+        if (glyphs[i].codepoint == codepoint && glyphs[i].line_height == line_height &&
+            (glyphs[i].valid || glyphs[i].received > 0)) {
+            return &glyphs[i];
+        }
+    }
+    return NULL;
+}
+
+// Returns a slot for a new glyph, or NULL if every slot is still being received. Partly
+// received slots are only reused once the host has stopped sending them.
+static struct glyph *glyph_evict(int64_t now) {
+    struct glyph *victim = NULL;
+
+    for (int i = 0; i < ARRAY_SIZE(glyphs); i++) {
+        struct glyph *glyph = &glyphs[i];
+
+        if (!glyph->valid) {
+            if (glyph->received == 0 || now - glyph->last_chunk >= GLYPH_STALE_MS) {
+                glyph->received = 0;
+                return glyph;
+            }
+            continue;
+        }
+        if (victim == NULL || glyph->last_used < victim->last_used) {
+            victim = glyph;
+        }
+    }
+
+    if (victim == NULL) {
+        return NULL;
+    }
+
+    stats.evictions++;
+    stats.bytes_used -= glyph_bitmap_size(&victim->dsc);
+    victim->valid = false;
+    return victim;
+}
+
+static void missing_add(uint32_t codepoint, uint8_t line_height) {
+    struct missing_glyph *free_slot = NULL;
+
+    for (int i = 0; i < ARRAY_SIZE(missing); i++) {
+        if (missing[i].codepoint == codepoint && missing[i].line_height == line_height) {
+            return;
+        }
+        if (free_slot == NULL && missing[i].codepoint == 0) {
+            free_slot = &missing[i];
+        }
+    }
+
+    if (free_slot == NULL) {
+        // too many outstanding requests, ask again on a later redraw
+        return;
+    }
+
+    free_slot->codepoint = codepoint;
+    free_slot->line_height = line_height;
+    free_slot->sent = false;
+    glyph_work_submit();
+}
+
+static void missing_remove(uint32_t codepoint, uint8_t line_height) {
+    for (int i = 0; i < ARRAY_SIZE(missing); i++) {
+        if (missing[i].codepoint == codepoint && missing[i].line_height == line_height) {
+            missing[i].codepoint = 0;
+        }
+    }
+}
+
+static void send_missing(void) {
+    uint8_t report[HID_REPORT_SIZE] = {_GLYPH, GLYPH_MISSING};
+    uint8_t count = 0;
+
+    for (int i = 0; i < ARRAY_SIZE(missing); i++) {
+        if (missing[i].codepoint == 0 || missing[i].sent) {
+            continue;
+        }
+
+        uint8_t *entry = &report[GLYPH_MISSING_HEADER_SIZE + count * GLYPH_MISSING_ENTRY_SIZE];
+        if (entry + GLYPH_MISSING_ENTRY_SIZE > report + sizeof(report)) {
+            glyph_work_submit();
+            break;
+        }
+
+        entry[0] = missing[i].line_height;
+        sys_put_le24(missing[i].codepoint, &entry[1]);
+        missing[i].sent = true;
+        count++;
+    }
+
+    if (count > 0) {
+        report[2] = count;
+        nice_view_hid_send(report, sizeof(report));
+    }
+}
+
+static bool glyph_get_dsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc, uint32_t letter,
+                          uint32_t letter_next) {
+    if (letter < 0x80) {
+        return false;
+    }
+
+    struct glyph *glyph = glyph_find(letter, font->line_height);
+    if (glyph == NULL || !glyph->valid) {
+        missing_add(letter, font->line_height);
+        return false;
+    }
+
+    glyph->last_used = ++use_counter;
+    *dsc = glyph->dsc;
+    return true;
+}
+
+static const uint8_t *glyph_get_bitmap(const lv_font_t *font, uint32_t letter) {
+    struct glyph *glyph = glyph_find(letter, font->line_height);
+    return glyph != NULL && glyph->valid ? glyph->bitmap : NULL;
+}
+
+static void glyph_apply(const uint8_t *data) {
+    if (data[1] != GLYPH_DATA) {
+        return;
+    }
+
+    uint8_t line_height = data[2];
+    uint32_t codepoint = sys_get_le24(&data[3]);
+    uint8_t offset = data[11];
+    lv_font_glyph_dsc_t dsc = {
+        .box_w = data[6],
+        .box_h = data[7],
+        .ofs_x = (int8_t)data[8],
+        .ofs_y = (int8_t)data[9],
+        .adv_w = data[10],
+        .bpp = 1,
+    };
+
+    size_t size = glyph_bitmap_size(&dsc);
+    if (dsc.box_w > GLYPH_MAX_SIZE || dsc.box_h > GLYPH_MAX_SIZE || offset >= MAX(size, 1)) {
+        LOG_WRN("glyph U+%04x rejected", codepoint);
+        return;
+    }
+
+    int64_t now = k_uptime_get();
+    struct glyph *glyph = glyph_find(codepoint, line_height);
+    if (glyph != NULL && glyph->valid) {
+        // host resent a glyph we already have
+        return;
+    }
+    if (glyph != NULL && offset == 0) {
+        // host restarted the transfer
+        glyph->received = 0;
+    }
+    if (glyph == NULL) {
+        if (offset != 0) {
+            LOG_DBG("glyph U+%04x chunk at %u without its start", codepoint, offset);
+            return;
+        }
+        glyph = glyph_evict(now);
+        if (glyph == NULL) {
+            LOG_DBG("glyph U+%04x dropped, all slots busy", codepoint);
+            return;
+        }
+        glyph->codepoint = codepoint;
+        glyph->line_height = line_height;
+    }
+    if (offset != glyph->received) {
+        LOG_DBG("glyph U+%04x chunk at %u, expected %u", codepoint, offset, glyph->received);
+        return;
+    }
+
+    size_t len = MIN(size - offset, HID_REPORT_SIZE - GLYPH_DATA_HEADER_SIZE);
+    memcpy(&glyph->bitmap[offset], &data[GLYPH_DATA_HEADER_SIZE], len);
+    glyph->received = offset + len;
+    glyph->last_chunk = now;
+    glyph->dsc = dsc;
+
+    if (glyph->received < size) {
+        return;
+    }
+
+    glyph->valid = true;
+    glyph->last_used = ++use_counter;
+    stats.bytes_used += size;
+    missing_remove(codepoint, line_height);
+
+    LOG_DBG("glyph U+%04x cached, hits %u misses %u evictions %u bytes %u", codepoint,
+            stats.hits, stats.misses, stats.evictions, stats.bytes_used);
+    raise_glyph_notification((struct glyph_notification){.codepoint = codepoint});
+}
+
+static void glyph_work_cb(struct k_work *work) {
+    uint8_t report[HID_REPORT_SIZE];
+
+    if (atomic_cas(&missing_reset, 1, 0)) {
+        memset(missing, 0, sizeof(missing));
+    }
+    if (atomic_cas(&reports_dropped, 1, 0)) {
+        for (int i = 0; i < ARRAY_SIZE(missing); i++) {
+            missing[i].sent = false;
+        }
+    }
+
+    while (k_msgq_get(&glyph_reports, report, K_NO_WAIT) == 0) {
+        glyph_apply(report);
+    }
+
+    send_missing();
+}
+
+void glyph_cache_process(const uint8_t *data) {
+    if (k_msgq_put(&glyph_reports, data, K_NO_WAIT) != 0) {
+        atomic_set(&reports_dropped, 1);
+    }
+    glyph_work_submit();
+}
+
+void glyph_cache_account(const char *text) {
+    uint32_t i = 0;
+    uint32_t letter;
+
+    while ((letter = _lv_txt_encoded_next(text, &i)) != 0) {
+        if (letter < 0x80) {
+            continue;
+        }
+
+        bool cached = false;
+        for (int j = 0; j < ARRAY_SIZE(glyphs); j++) {
+            if (glyphs[j].valid && glyphs[j].codepoint == letter) {
+                cached = true;
+                break;
+            }
+        }
+        if (cached) {
+            stats.hits++;
+        } else {
+            stats.misses++;
+        }
+    }
+}
+
+// Built-in fonts are const, so each one used with glyph_font() gets a writable copy whose
+// fallback points at the cache.
+struct glyph_font_pair {
+    const lv_font_t *base;
+    lv_font_t font;
+    lv_font_t fallback;
+};
+
+static struct glyph_font_pair fonts[3];
+
+const lv_font_t *glyph_font(const lv_font_t *base) {
+    for (int i = 0; i < ARRAY_SIZE(fonts); i++) {
+        struct glyph_font_pair *pair = &fonts[i];
+
+        if (pair->base == base) {
+            return &pair->font;
+        }
+        if (pair->base != NULL) {
+            continue;
+        }
+
+        pair->base = base;
+        pair->fallback = (lv_font_t){
+            .get_glyph_dsc = glyph_get_dsc,
+            .get_glyph_bitmap = glyph_get_bitmap,
+            .line_height = base->line_height,
+            .base_line = base->base_line,
+        };
+        pair->font = *base;
+        pair->font.fallback = &pair->fallback;
+        return &pair->font;
+    }
+
+    return base;
+}
+
+static int glyph_connection_listener(const zmk_event_t *eh) {
+    const struct is_connected_notification *conn = as_is_connected_notification(eh);
+    if (conn && !conn->value) {
+        // a new host may have a different font renderer, ask again
+        atomic_set(&missing_reset, 1);
+        glyph_work_submit();
+    }
+
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(nice_view_hid_glyphs, glyph_connection_listener);
+ZMK_SUBSCRIPTION(nice_view_hid_glyphs, is_connected_notification);
+
+void glyph_cache_get_stats(struct glyph_cache_stats *out) { *out = stats; }
@@ -1,8 +1,22 @@
 #include <nice_view_hid/hid.h>
+#ifdef CONFIG_NICE_VIEW_HID_TILES
+#include <nice_view_hid/tiles.h>
+#endif
+#ifdef CONFIG_NICE_VIEW_HID_GLYPHS
+#include <nice_view_hid/glyphs.h>
+#endif
+#ifdef CONFIG_NICE_VIEW_HID_FLOW_CONTROL
+#include <nice_view_hid/flow.h>
+#endif
 #include <raw_hid/events.h>
 
 #include <zephyr/kernel.h>
 
+#if !IS_ENABLED(CONFIG_ZMK_SPLIT) || IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
+#include <zmk/endpoints.h>
+#include <zmk/events/endpoint_changed.h>
+#endif
+
 #include <zephyr/logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
@@ -14,63 +28,297 @@ ZMK_EVENT_IMPL(media_artist_notification);
 #ifdef CONFIG_NICE_VIEW_HID_SHOW_LAYOUT
 ZMK_EVENT_IMPL(layout_notification);
 #endif
+#ifdef CONFIG_NICE_VIEW_HID_SPARKLINE
+ZMK_EVENT_IMPL(metric_notification);
+#endif
 
-typedef enum {
-    _TIME = 0xAA,
-    _VOLUME,
-    _LAYOUT,
-    _MEDIA_ARTIST = 0xAD,
-    _MEDIA_TITLE,
-} hid_data_type;
+// only the central (or a unibody board) has endpoints to switch between
+#define IS_HOST_ROLE (!IS_ENABLED(CONFIG_ZMK_SPLIT) || IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL))
 
-static bool is_connected = false;
+// The host's cadence is only learned from reports it sends on a schedule, heartbeats and time.
+// Volume and media reports follow user activity and come in bursts, so they keep the link alive
+// but say nothing about when the next report is due. Shorter intervals are counted as this long.
+#define LINK_BURST_MS 250
 
-static void on_disconnect_timer(struct k_timer *dummy) {
-    LOG_INF("raise_connection_notification: false");
-    is_connected = false;
-    raise_is_connected_notification((struct is_connected_notification){.value = false});
+// last known state of each host, so switching endpoints can show it right away
+struct host_state {
+    bool is_connected;
+    int64_t last_packet;
+    int64_t last_cadence_packet;
+    // link health: smoothed gap between scheduled reports, 0 until the first sample
+    uint32_t interval_ewma;
+    // longest recent gap between scheduled reports, decays slowly
+    uint32_t gap_max;
+    uint32_t packets;
+    uint32_t timeouts;
+    uint8_t connect_packets;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t volume;
+    uint8_t layout;
+    char title[32];
+    char artist[32];
+};
+
+#if IS_HOST_ROLE
+#define HOST_COUNT ZMK_ENDPOINT_COUNT
+#else
+#define HOST_COUNT 1
+#endif
+
+static struct host_state hosts[HOST_COUNT];
+
+// state of the host on the selected endpoint, the one the screen shows
+static struct host_state *current_host(void) {
+#if IS_HOST_ROLE
+    int index = zmk_endpoint_instance_to_index(zmk_endpoints_selected());
+    if (index >= 0 && index < HOST_COUNT) {
+        return &hosts[index];
+    }
+#endif
+    return &hosts[0];
+}
+
+enum hid_deadline {
+    DEADLINE_DISCONNECT,
+    DEADLINE_VOLUME,
+    DEADLINE_COUNT,
+};
+
+static void on_disconnect_deadline(void);
+static void on_volume_deadline(void);
+
+static void (*const deadline_handlers[DEADLINE_COUNT])(void) = {
+    [DEADLINE_DISCONNECT] = on_disconnect_deadline,
+    [DEADLINE_VOLUME] = on_volume_deadline,
+};
+
+// All deadlines share one kernel timer, armed for the earliest pending one. Moving a deadline
+// later does not touch the timer; it is picked up when the timer fires for the old deadline.
+// 0 means not pending / not armed.
+//
+// The timer expires in interrupt context, so it only submits deadline_work. Due deadlines are
+// run from the work item, where handlers can log and raise events.
+static int64_t deadlines[DEADLINE_COUNT];
+static int64_t armed_at;
+static struct k_spinlock deadline_lock;
+
+static uint32_t deadline_wakeups;
+static uint32_t deadline_rearms;
+static int64_t deadline_stats_since;
+
+static void on_deadline_work(struct k_work *work);
+static K_WORK_DEFINE(deadline_work, on_deadline_work);
+
+static void on_deadline_timer(struct k_timer *dummy) { k_work_submit(&deadline_work); }
+
+K_TIMER_DEFINE(deadline_timer, on_deadline_timer, NULL);
+
+// called with deadline_lock held
+static void arm_deadline_timer(void) {
+    int64_t earliest = 0;
+    for (int i = 0; i < DEADLINE_COUNT; i++) {
+        if (deadlines[i] != 0 && (earliest == 0 || deadlines[i] < earliest)) {
+            earliest = deadlines[i];
+        }
+    }
+
+    if (earliest == armed_at) {
+        return;
+    }
+
+    armed_at = earliest;
+    if (earliest == 0) {
+        k_timer_stop(&deadline_timer);
+        return;
+    }
+
+    deadline_rearms++;
+    k_timer_start(&deadline_timer, K_MSEC(MAX(earliest - k_uptime_get(), 0)), K_NO_WAIT);
+}
+
+static void set_deadline(enum hid_deadline id, int64_t at) {
+    k_spinlock_key_t key = k_spin_lock(&deadline_lock);
+    deadlines[id] = at;
+    if (armed_at == 0 || at < armed_at) {
+        arm_deadline_timer();
+    }
+    k_spin_unlock(&deadline_lock, key);
+}
+
+static void cancel_deadline(enum hid_deadline id) {
+    // the timer is left armed, an early wakeup just finds nothing due
+    k_spinlock_key_t key = k_spin_lock(&deadline_lock);
+    deadlines[id] = 0;
+    k_spin_unlock(&deadline_lock, key);
+}
+
+static void on_deadline_work(struct k_work *work) {
+    int64_t now = k_uptime_get();
+    uint32_t due = 0;
+
+    k_spinlock_key_t key = k_spin_lock(&deadline_lock);
+    deadline_wakeups++;
+    armed_at = 0;
+    for (int i = 0; i < DEADLINE_COUNT; i++) {
+        if (deadlines[i] != 0 && deadlines[i] <= now) {
+            deadlines[i] = 0;
+            due |= BIT(i);
+        }
+    }
+    arm_deadline_timer();
+    k_spin_unlock(&deadline_lock, key);
+
+    if (now - deadline_stats_since >= 60 * MSEC_PER_SEC) {
+        LOG_INF("deadline timer: %u wakeups, %u rearms in the last minute", deadline_wakeups,
+                deadline_rearms);
+        deadline_wakeups = 0;
+        deadline_rearms = 0;
+        deadline_stats_since = now;
+    }
+
+    // handlers may set new deadlines, so they run without the lock
+    for (int i = 0; i < DEADLINE_COUNT; i++) {
+        if (due & BIT(i)) {
+            deadline_handlers[i]();
+        }
+    }
+}
+
+// disconnect after a few missed host intervals, within the configured bounds, but never before
+// the longest gap seen recently has passed
+static uint32_t link_timeout(const struct host_state *host) {
+    if (host->interval_ewma == 0) {
+        return CONFIG_NICE_VIEW_HID_LINK_TIMEOUT_MAX_MS;
+    }
+    uint32_t timeout = MAX(host->interval_ewma * CONFIG_NICE_VIEW_HID_LINK_TIMEOUT_FACTOR,
+                           host->gap_max + LINK_BURST_MS);
+    return CLAMP(timeout, CONFIG_NICE_VIEW_HID_LINK_TIMEOUT_MIN_MS,
+                 CONFIG_NICE_VIEW_HID_LINK_TIMEOUT_MAX_MS);
+}
+
+static bool is_cadence_report(uint8_t data_type) {
+    return data_type == _HEARTBEAT || data_type == _TIME;
+}
+
+static void link_packet_received(struct host_state *host, uint8_t data_type, int64_t now) {
+    if (is_cadence_report(data_type)) {
+        if (host->last_cadence_packet != 0) {
+            uint32_t interval = CLAMP(now - host->last_cadence_packet, LINK_BURST_MS,
+                                      CONFIG_NICE_VIEW_HID_LINK_TIMEOUT_MAX_MS);
+            // exponentially weighted average, alpha = 1/8
+            host->interval_ewma =
+                host->interval_ewma == 0 ? interval : (host->interval_ewma * 7 + interval) / 8;
+            // a long gap is forgotten by 1/16 per scheduled report
+            host->gap_max = MAX(interval, host->gap_max - host->gap_max / 16);
+        }
+        host->last_cadence_packet = now;
+    }
+
+    host->last_packet = now;
+    host->packets++;
+}
+
+void nice_view_hid_link_stats(struct link_stats *stats) {
+    const struct host_state *host = current_host();
+
+    *stats = (struct link_stats){
+        .is_connected = host->is_connected,
+        .packets = host->packets,
+        .timeouts = host->timeouts,
+        .interval_ms = host->interval_ewma,
+        .timeout_ms = link_timeout(host),
+    };
 }
 
-K_TIMER_DEFINE(disconnect_timer, on_disconnect_timer, NULL);
+static void on_disconnect_deadline(void) {
+    struct host_state *host = current_host();
+
+    host->connect_packets = 0;
+    if (!host->is_connected) {
+        return;
+    }
+
+    host->timeouts++;
+    LOG_INF("raise_connection_notification: false, interval %u ms, timeout %u ms, %u timeouts",
+            host->interval_ewma, link_timeout(host), host->timeouts);
+    host->is_connected = false;
+    raise_is_connected_notification((struct is_connected_notification){.value = false});
+}
 
-static uint8_t last_hid_volume = 0;
 static uint8_t last_raised_volume = 0;
 
-static void on_volume_timer(struct k_timer *dummy) {
+static void on_volume_deadline(void) {
+    uint8_t volume = current_host()->volume;
+
     // prevent raising event with the same value multiple times
-    if (last_raised_volume != last_hid_volume) {
-        last_raised_volume = last_hid_volume;
-        LOG_INF("raise_volume_notification %i", last_hid_volume);
-        raise_volume_notification((struct volume_notification){.value = last_hid_volume});
+    if (last_raised_volume != volume) {
+        last_raised_volume = volume;
+        LOG_INF("raise_volume_notification %i", volume);
+        raise_volume_notification((struct volume_notification){.value = volume});
     }
 }
 
-K_TIMER_DEFINE(volume_timer, on_volume_timer, NULL);
+// The raw HID module only has a USB interface and its event doesn't say where a report came
+// from, so every report is from the USB host. While another endpoint is selected they are
+// dropped rather than filed under that endpoint; the companion resends its state once USB is
+// selected again. A raw HID transport over BLE would need the source in the event.
+static bool report_from_selected(void) {
+#if IS_HOST_ROLE
+    return zmk_endpoints_selected().transport == ZMK_TRANSPORT_USB;
+#else
+    return true;
+#endif
+}
 
 static void process_raw_hid_data(uint8_t *data) {
     LOG_INF("display_process_raw_hid_data - received data_type %u", data[0]);
 
-    // raise disconnect notification after 65 seconds of inactivity
-    k_timer_start(&disconnect_timer, K_SECONDS(65), K_NO_WAIT);
-    if (!is_connected) {
-        LOG_INF("raise_connection_notification: true");
-        is_connected = true;
-        raise_is_connected_notification((struct is_connected_notification){.value = true});
+    if (!report_from_selected()) {
+        LOG_DBG("dropping data_type %u, USB is not the selected endpoint", data[0]);
+        return;
     }
 
+    struct host_state *host = current_host();
+    int64_t now = k_uptime_get();
     uint8_t data_type = data[0];
+    bool in_time = host->last_packet != 0 && now - host->last_packet < link_timeout(host);
+    link_packet_received(host, data_type, now);
+
+    // raise disconnect notification once the host misses its usual cadence
+    set_deadline(DEADLINE_DISCONNECT, now + link_timeout(host));
+
+    // hysteresis: a disconnected host has to send a few packets in a row to count as back
+    if (!host->is_connected) {
+        host->connect_packets = in_time ? host->connect_packets + 1 : 1;
+        if (host->connect_packets >= CONFIG_NICE_VIEW_HID_LINK_CONNECT_PACKETS) {
+            LOG_INF("raise_connection_notification: true");
+            host->is_connected = true;
+            raise_is_connected_notification((struct is_connected_notification){.value = true});
+        }
+    }
+
+#ifdef CONFIG_NICE_VIEW_HID_FLOW_CONTROL
+    flow_control_track(data_type);
+#endif
     switch (data_type) {
+    case _HEARTBEAT:
+        // only keeps the link alive
+        break;
+
     case _TIME:
+        host->hour = data[1];
+        host->minute = data[2];
         raise_time_notification((struct time_notification){.hour = data[1], .minute = data[2]});
         break;
 
     case _VOLUME:
-        last_hid_volume = data[1];
+        host->volume = data[1];
 
         // debounce volume change events
-        if (k_timer_status_get(&volume_timer) > 0 || k_timer_remaining_get(&volume_timer) == 0) {
-            k_timer_start(&volume_timer, K_MSEC(150), K_NO_WAIT);
-            on_volume_timer(&volume_timer);
+        if (deadlines[DEADLINE_VOLUME] == 0) {
+            set_deadline(DEADLINE_VOLUME, host->last_packet + 150);
+            on_volume_deadline();
         }
 
         break;
@@ -81,6 +329,7 @@ static void process_raw_hid_data(uint8_t *data) {
         struct media_artist_notification notif = {.artist = {0}};
         memcpy(notif.artist, data + 2, len);
         notif.artist[len] = '\0';
+        strcpy(host->artist, notif.artist);
         raise_media_artist_notification(notif);
         break;
     }
@@ -90,18 +339,108 @@ static void process_raw_hid_data(uint8_t *data) {
         struct media_title_notification notif = {.title = {0}};
         memcpy(notif.title, data + 2, len);
         notif.title[len] = '\0';
+        strcpy(host->title, notif.title);
         raise_media_title_notification(notif);
         break;
     }
 
 #ifdef CONFIG_NICE_VIEW_HID_SHOW_LAYOUT
     case _LAYOUT:
+        host->layout = data[1];
         raise_layout_notification((struct layout_notification){.value = data[1]});
         break;
 #endif
+
+#ifdef CONFIG_NICE_VIEW_HID_SPARKLINE
+    case _METRIC:
+        raise_metric_notification((struct metric_notification){.id = data[1], .value = data[2]});
+        break;
+#endif
+
+#ifdef CONFIG_NICE_VIEW_HID_TILES
+    case _IMAGE:
+        tile_cache_process(data);
+        break;
+#endif
+
+#ifdef CONFIG_NICE_VIEW_HID_GLYPHS
+    case _GLYPH:
+        glyph_cache_process(data);
+        break;
+#endif
+
+#ifdef CONFIG_NICE_VIEW_HID_FLOW_CONTROL
+    case _CAPS:
+        flow_control_process(data);
+        break;
+#endif
+    }
+}
+
+void nice_view_hid_send(const uint8_t *data, uint8_t length) {
+    // senders run on different threads, the event is handled synchronously so the stack will do
+    uint8_t report[HID_REPORT_SIZE] = {0};
+
+    memcpy(report, data, MIN(length, sizeof(report)));
+    raise_raw_hid_sent_event((struct raw_hid_sent_event){.data = report, .length = sizeof(report)});
+}
+
+#if IS_HOST_ROLE
+
+static void restore_host_state(void) {
+    struct host_state *host = current_host();
+
+    cancel_deadline(DEADLINE_VOLUME);
+    cancel_deadline(DEADLINE_DISCONNECT);
+
+    if (host->is_connected) {
+        // resume the new host's inactivity window instead of restarting it
+        int64_t deadline = host->last_packet + link_timeout(host);
+        if (deadline > k_uptime_get()) {
+            set_deadline(DEADLINE_DISCONNECT, deadline);
+        } else {
+            host->is_connected = false;
+        }
+    }
+
+    LOG_INF("raise_connection_notification: %i", host->is_connected);
+    raise_is_connected_notification(
+        (struct is_connected_notification){.value = host->is_connected});
+    if (!host->is_connected) {
+        return;
+    }
+
+    raise_time_notification((struct time_notification){.hour = host->hour, .minute = host->minute});
+
+    last_raised_volume = host->volume;
+    raise_volume_notification((struct volume_notification){.value = host->volume});
+
+#ifdef CONFIG_NICE_VIEW_HID_SHOW_LAYOUT
+    raise_layout_notification((struct layout_notification){.value = host->layout});
+#endif
+
+    struct media_title_notification title = {.title = {0}};
+    strcpy(title.title, host->title);
+    raise_media_title_notification(title);
+
+    struct media_artist_notification artist = {.artist = {0}};
+    strcpy(artist.artist, host->artist);
+    raise_media_artist_notification(artist);
+}
+
+static int endpoint_changed_listener(const zmk_event_t *eh) {
+    if (as_zmk_endpoint_changed(eh)) {
+        restore_host_state();
     }
+
+    return ZMK_EV_EVENT_BUBBLE;
 }
 
+ZMK_LISTENER(nice_view_hid_endpoint, endpoint_changed_listener);
+ZMK_SUBSCRIPTION(nice_view_hid_endpoint, zmk_endpoint_changed);
+
+#endif // IS_HOST_ROLE
+
 static int raw_hid_received_event_listener(const zmk_event_t *eh) {
     struct raw_hid_received_event *event = as_raw_hid_received_event(eh);
     if (event) {
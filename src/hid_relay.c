@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) 2023 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#define DT_DRV_COMPAT zmk_behavior_nice_view_hid_relay
+
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE) && IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
+#include <zephyr/bluetooth/conn.h>
+#endif
+
+#include <drivers/behavior.h>
+#include <zmk/behavior.h>
+#include <zmk/event_manager.h>
+#include <nice_view_hid/hid.h>
+#include <nice_view_hid/relay_frame.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#if DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT)
+
+// Raw HID reports only arrive on the central. The central forwards the resulting state to the
+// peripherals by invoking this global behavior, using its two 32-bit params as an 8-byte frame
+// (see relay_frame.h). Only chunks that differ from what was last sent are transmitted.
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
+
+// latest state received from the host, written by the listener and read by the flush
+static struct relay_state pending;
+static struct k_spinlock pending_lock;
+// state the peripherals have been sent so far
+static struct relay_state sent;
+// scalar fields that must be sent even if unchanged
+static uint8_t forced_scalars;
+// set when a peripheral or the host (re)connects, handled on the next flush
+static atomic_t resync_requested;
+
+// a frame that couldn't be sent is retried after this long, and again once a peripheral connects
+#define RELAY_RETRY_MS 1000
+
+static void relay_flush(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(relay_work, relay_flush);
+
+static void relay_request_resync(void) {
+    atomic_set(&resync_requested, 1);
+    k_work_schedule(&relay_work, K_MSEC(CONFIG_NICE_VIEW_HID_SPLIT_RELAY_INTERVAL_MS));
+}
+
+static void relay_resync(void) {
+    // shadow strings that can't match anything force every chunk to be resent
+    forced_scalars = RELAY_ALL_SCALARS;
+    memset(sent.title, 0xFF, RELAY_STR_LEN);
+    memset(sent.artist, 0xFF, RELAY_STR_LEN);
+}
+
+static int relay_send(const uint8_t frame[RELAY_FRAME_SIZE]) {
+    struct zmk_behavior_binding binding = {
+        .behavior_dev = DEVICE_DT_NAME(DT_DRV_INST(0)),
+        .param1 = sys_get_le32(&frame[0]),
+        .param2 = sys_get_le32(&frame[4]),
+    };
+    struct zmk_behavior_binding_event event = {
+        .position = 0,
+        .timestamp = k_uptime_get(),
+    };
+
+    int ret = zmk_behavior_invoke_binding(&binding, event, true);
+    if (ret < 0) {
+        LOG_WRN("relay frame 0x%02x not sent: %d", frame[0], ret);
+    }
+    return ret;
+}
+
+static uint8_t relay_dirty_scalars(const struct relay_state *state) {
+    return forced_scalars | relay_changed_scalars(state, &sent);
+}
+
+// Returns the bytes sent, or -EAGAIN if a frame couldn't be sent. The shadow copy is only
+// updated for frames that went out, so anything unsent stays dirty and is retried.
+static int relay_flush_scalars(const struct relay_state *state, size_t budget) {
+    uint8_t mask = relay_dirty_scalars(state);
+    if (mask == 0 || budget < RELAY_FRAME_SIZE) {
+        return 0;
+    }
+
+    uint8_t frame[RELAY_FRAME_SIZE];
+    relay_encode_scalars(frame, state, mask);
+    if (relay_send(frame) < 0) {
+        return -EAGAIN;
+    }
+
+    sent.is_connected = state->is_connected;
+    sent.hour = state->hour;
+    sent.minute = state->minute;
+    sent.volume = state->volume;
+    sent.layout = state->layout;
+    forced_scalars = 0;
+    return RELAY_FRAME_SIZE;
+}
+
+static int relay_flush_string(enum relay_frame_kind kind, const char *pending_str, char *sent_str,
+                              size_t budget) {
+    if (memcmp(pending_str, sent_str, RELAY_STR_LEN) == 0) {
+        return 0;
+    }
+
+    uint8_t last = relay_last_chunk(pending_str);
+    size_t used = 0;
+
+    for (uint8_t chunk = 0; chunk <= last; chunk++) {
+        size_t offset = chunk * RELAY_CHUNK_SIZE;
+        size_t size = MIN(RELAY_CHUNK_SIZE, RELAY_STR_LEN - offset);
+
+        if (!relay_chunk_needed(pending_str, sent_str, chunk)) {
+            continue;
+        }
+        if (used + RELAY_FRAME_SIZE > budget) {
+            // out of budget, the rest goes out with the next batch
+            return used;
+        }
+
+        uint8_t frame[RELAY_FRAME_SIZE];
+        relay_encode_chunk(frame, kind, pending_str, chunk);
+        if (relay_send(frame) < 0) {
+            return -EAGAIN;
+        }
+
+        memcpy(&sent_str[offset], &pending_str[offset], size);
+        used += RELAY_FRAME_SIZE;
+    }
+
+    // the whole string was delivered, make the shadow copy match byte for byte
+    memcpy(sent_str, pending_str, RELAY_STR_LEN);
+    return used;
+}
+
+static void relay_flush(struct k_work *work) {
+    size_t budget = CONFIG_NICE_VIEW_HID_SPLIT_RELAY_BUDGET;
+    size_t used = 0;
+    int ret;
+
+    if (atomic_cas(&resync_requested, 1, 0)) {
+        relay_resync();
+    }
+
+    // frames are built from a snapshot, so a report arriving meanwhile can't tear a string
+    k_spinlock_key_t key = k_spin_lock(&pending_lock);
+    struct relay_state state = pending;
+    k_spin_unlock(&pending_lock, key);
+
+    ret = relay_flush_scalars(&state, budget - used);
+    if (ret >= 0) {
+        used += ret;
+        ret = relay_flush_string(RELAY_TITLE, state.title, sent.title, budget - used);
+    }
+    if (ret >= 0) {
+        used += ret;
+        ret = relay_flush_string(RELAY_ARTIST, state.artist, sent.artist, budget - used);
+    }
+    if (ret >= 0) {
+        used += ret;
+    }
+
+    LOG_DBG("relay batch sent %zu bytes", used);
+
+    if (ret < 0) {
+        // split link is down or busy, don't keep it awake retrying every interval
+        k_work_schedule(&relay_work, K_MSEC(RELAY_RETRY_MS));
+    } else if (relay_dirty_scalars(&state) != 0 ||
+               memcmp(&state.title, &sent.title, RELAY_STR_LEN) != 0 ||
+               memcmp(&state.artist, &sent.artist, RELAY_STR_LEN) != 0) {
+        k_work_schedule(&relay_work, K_MSEC(CONFIG_NICE_VIEW_HID_SPLIT_RELAY_INTERVAL_MS));
+    }
+}
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE)
+// A peripheral that reconnects may have rebooted or missed frames, so it gets everything again.
+// Connections where we are the central are the split peripherals, hosts connect to us.
+static void relay_connected(struct bt_conn *conn, uint8_t err) {
+    struct bt_conn_info info;
+
+    if (err || bt_conn_get_info(conn, &info) < 0 || info.role != BT_CONN_ROLE_CENTRAL) {
+        return;
+    }
+
+    LOG_DBG("split peripheral connected, resending relay state");
+    relay_request_resync();
+}
+
+BT_CONN_CB_DEFINE(nice_view_hid_relay_conn_cb) = {
+    .connected = relay_connected,
+};
+#endif
+
+static int relay_event_listener(const zmk_event_t *eh) {
+    k_spinlock_key_t key = k_spin_lock(&pending_lock);
+
+    const struct is_connected_notification *conn = as_is_connected_notification(eh);
+    if (conn) {
+        if (conn->value && !pending.is_connected) {
+            // peripherals may have missed updates while the host was away, resend everything
+            atomic_set(&resync_requested, 1);
+        }
+        pending.is_connected = conn->value;
+    }
+
+    const struct time_notification *time = as_time_notification(eh);
+    if (time) {
+        pending.hour = time->hour;
+        pending.minute = time->minute;
+    }
+
+    const struct volume_notification *volume = as_volume_notification(eh);
+    if (volume) {
+        pending.volume = volume->value;
+    }
+
+#ifdef CONFIG_NICE_VIEW_HID_SHOW_LAYOUT
+    const struct layout_notification *layout = as_layout_notification(eh);
+    if (layout) {
+        pending.layout = layout->value;
+    }
+#endif
+
+    const struct media_title_notification *title = as_media_title_notification(eh);
+    if (title) {
+        memset(pending.title, 0, RELAY_STR_LEN);
+        strncpy(pending.title, title->title, RELAY_STR_LEN - 1);
+    }
+
+    const struct media_artist_notification *artist = as_media_artist_notification(eh);
+    if (artist) {
+        memset(pending.artist, 0, RELAY_STR_LEN);
+        strncpy(pending.artist, artist->artist, RELAY_STR_LEN - 1);
+    }
+
+    k_spin_unlock(&pending_lock, key);
+
+    // batch everything that arrives within one interval into a single flush
+    k_work_schedule(&relay_work, K_MSEC(CONFIG_NICE_VIEW_HID_SPLIT_RELAY_INTERVAL_MS));
+
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(nice_view_hid_relay, relay_event_listener);
+ZMK_SUBSCRIPTION(nice_view_hid_relay, is_connected_notification);
+ZMK_SUBSCRIPTION(nice_view_hid_relay, time_notification);
+ZMK_SUBSCRIPTION(nice_view_hid_relay, volume_notification);
+#ifdef CONFIG_NICE_VIEW_HID_SHOW_LAYOUT
+ZMK_SUBSCRIPTION(nice_view_hid_relay, layout_notification);
+#endif
+ZMK_SUBSCRIPTION(nice_view_hid_relay, media_title_notification);
+ZMK_SUBSCRIPTION(nice_view_hid_relay, media_artist_notification);
+
+#else
+
+// state as last received, string chunks are assembled here until the terminating chunk arrives
+static struct relay_state received;
+
+static void relay_receive_scalars(const uint8_t frame[RELAY_FRAME_SIZE]) {
+    uint8_t mask = relay_decode_scalars(frame, &received);
+
+    if (mask & RELAY_CONNECTED) {
+        raise_is_connected_notification(
+            (struct is_connected_notification){.value = received.is_connected});
+    }
+    if (mask & RELAY_TIME) {
+        raise_time_notification(
+            (struct time_notification){.hour = received.hour, .minute = received.minute});
+    }
+    if (mask & RELAY_VOLUME) {
+        raise_volume_notification((struct volume_notification){.value = received.volume});
+    }
+#ifdef CONFIG_NICE_VIEW_HID_SHOW_LAYOUT
+    if (mask & RELAY_LAYOUT) {
+        raise_layout_notification((struct layout_notification){.value = received.layout});
+    }
+#endif
+}
+
+static void relay_receive(const uint8_t frame[RELAY_FRAME_SIZE]) {
+    switch (RELAY_HEADER_KIND(frame[0])) {
+    case RELAY_SCALARS:
+        relay_receive_scalars(frame);
+        break;
+
+    case RELAY_TITLE:
+        if (relay_decode_chunk(received.title, frame)) {
+            struct media_title_notification notif = {.title = {0}};
+            strcpy(notif.title, received.title);
+            raise_media_title_notification(notif);
+        }
+        break;
+
+    case RELAY_ARTIST:
+        if (relay_decode_chunk(received.artist, frame)) {
+            struct media_artist_notification notif = {.artist = {0}};
+            strcpy(notif.artist, received.artist);
+            raise_media_artist_notification(notif);
+        }
+        break;
+
+    default:
+        LOG_WRN("unknown relay frame 0x%02x", frame[0]);
+        break;
+    }
+}
+
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
+
+static int on_relay_binding_pressed(struct zmk_behavior_binding *binding,
+                                    struct zmk_behavior_binding_event event) {
+#if !IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
+    uint8_t frame[RELAY_FRAME_SIZE];
+    sys_put_le32(binding->param1, &frame[0]);
+    sys_put_le32(binding->param2, &frame[4]);
+    relay_receive(frame);
+#endif
+    // the central raised the notifications itself, nothing to do locally
+    return ZMK_BEHAVIOR_OPAQUE;
+}
+
+static int on_relay_binding_released(struct zmk_behavior_binding *binding,
+                                     struct zmk_behavior_binding_event event) {
+    return ZMK_BEHAVIOR_OPAQUE;
+}
+
+static const struct behavior_driver_api behavior_nice_view_hid_relay_driver_api = {
+    .binding_pressed = on_relay_binding_pressed,
+    .binding_released = on_relay_binding_released,
+    .locality = BEHAVIOR_LOCALITY_GLOBAL,
+};
+
+static int behavior_nice_view_hid_relay_init(const struct device *dev) { return 0; }
+
+BEHAVIOR_DT_INST_DEFINE(0, behavior_nice_view_hid_relay_init, NULL, NULL, NULL, POST_KERNEL,
+                        CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+                        &behavior_nice_view_hid_relay_driver_api);
+
+#endif // DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT)
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2023 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <nice_view_hid/mem_stats.h>
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+
+#include <lvgl.h>
+#include <zmk/display.h>
+
+#if LV_MEM_CUSTOM
+#include <lvgl_mem.h>
+#endif
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+// Samples are taken on the display work queue, the only thread that touches LVGL.
+//
+// LVGL's own allocator keeps statistics that lv_mem_monitor() returns. With Zephyr's LVGL heap
+// (LV_MEM_CUSTOM) the monitor has nothing to report and the sys_heap it allocates from is
+// private to Zephyr's lvgl_mem.c, so sys_heap_runtime_stats_get() can't be called on it.
+// lvgl_print_heap_info() is the one way to read that heap; it prints Zephyr's heap report,
+// which includes the runtime statistics when CONFIG_SYS_HEAP_RUNTIME_STATS is enabled.
+
+static struct display_mem_stats last;
+static K_MUTEX_DEFINE(last_lock);
+
+#if LV_MEM_CUSTOM
+static void sample_heap(struct display_mem_stats *stats) {
+    ARG_UNUSED(stats);
+    lvgl_print_heap_info(false);
+}
+#else
+static void sample_heap(struct display_mem_stats *stats) {
+    lv_mem_monitor_t monitor;
+    lv_mem_monitor(&monitor);
+
+    stats->heap_known = true;
+    stats->heap_size = monitor.total_size;
+    stats->heap_free = monitor.free_size;
+    stats->heap_largest_free = monitor.free_biggest_size;
+    stats->heap_used_max = monitor.max_used;
+    stats->heap_frag_pct = monitor.frag_pct;
+
+    LOG_INF("lvgl heap %zu/%zu B free, largest %zu B, frag %u%%, max used %zu B",
+            stats->heap_free, stats->heap_size, stats->heap_largest_free, stats->heap_frag_pct,
+            stats->heap_used_max);
+}
+#endif
+
+static void sample_stack(struct display_mem_stats *stats) {
+    struct k_thread *thread = &zmk_display_work_q()->thread;
+    size_t unused = 0;
+
+    stats->stack_size = thread->stack_info.size;
+    if (k_thread_stack_space_get(thread, &unused) == 0) {
+        stats->stack_used_max = stats->stack_size - unused;
+    }
+}
+
+static void sample(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(sample_work, sample);
+
+static void sample(struct k_work *work) {
+    struct display_mem_stats stats = last;
+
+    sample_heap(&stats);
+    sample_stack(&stats);
+
+    LOG_INF("display stack %zu/%zu B used", stats.stack_used_max, stats.stack_size);
+
+    k_mutex_lock(&last_lock, K_FOREVER);
+    last = stats;
+    k_mutex_unlock(&last_lock);
+
+    k_work_schedule_for_queue(zmk_display_work_q(), &sample_work,
+                              K_MSEC(CONFIG_NICE_VIEW_HID_MEM_STATS_INTERVAL_MS));
+}
+
+void display_mem_stats_get(struct display_mem_stats *stats) {
+    k_mutex_lock(&last_lock, K_FOREVER);
+    *stats = last;
+    k_mutex_unlock(&last_lock);
+}
+
+static int mem_stats_init(void) {
+    k_work_schedule_for_queue(zmk_display_work_q(), &sample_work,
+                              K_MSEC(CONFIG_NICE_VIEW_HID_MEM_STATS_INTERVAL_MS));
+    return 0;
+}
+
+SYS_INIT(mem_stats_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
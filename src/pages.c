@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2023 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#define DT_DRV_COMPAT zmk_behavior_nice_view_hid_page
+
+#include <zephyr/device.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+
+#include <drivers/behavior.h>
+#include <zmk/behavior.h>
+#include <zmk/event_manager.h>
+#include <zmk/events/activity_state_changed.h>
+#include <nice_view_hid/pages.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+ZMK_EVENT_IMPL(page_notification);
+
+// Pages are switched by the page behavior or, with CONFIG_NICE_VIEW_HID_PAGE_CYCLE_MS set,
+// cycled automatically. Switching by hand restarts the cycle so the chosen page stays up for
+// a full interval. The cycle stops while the keyboard is idle, so it doesn't keep redrawing a
+// display that is blanked or about to sleep, and starts over once it is active again.
+static void cycle_page(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(cycle_work, cycle_page);
+
+static void next_page(void) {
+    raise_page_notification((struct page_notification){.step = 1});
+
+    if (CONFIG_NICE_VIEW_HID_PAGE_CYCLE_MS > 0) {
+        k_work_reschedule(&cycle_work, K_MSEC(CONFIG_NICE_VIEW_HID_PAGE_CYCLE_MS));
+    }
+}
+
+static void cycle_page(struct k_work *work) { next_page(); }
+
+static int pages_init(void) {
+    if (CONFIG_NICE_VIEW_HID_PAGE_CYCLE_MS > 0) {
+        k_work_schedule(&cycle_work, K_MSEC(CONFIG_NICE_VIEW_HID_PAGE_CYCLE_MS));
+    }
+    return 0;
+}
+
+SYS_INIT(pages_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+static int pages_activity_listener(const zmk_event_t *eh) {
+    struct zmk_activity_state_changed *ev = as_zmk_activity_state_changed(eh);
+    if (ev == NULL || CONFIG_NICE_VIEW_HID_PAGE_CYCLE_MS == 0) {
+        return ZMK_EV_EVENT_BUBBLE;
+    }
+
+    if (ev->state == ZMK_ACTIVITY_ACTIVE) {
+        k_work_reschedule(&cycle_work, K_MSEC(CONFIG_NICE_VIEW_HID_PAGE_CYCLE_MS));
+    } else {
+        k_work_cancel_delayable(&cycle_work);
+    }
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(nice_view_hid_pages, pages_activity_listener);
+ZMK_SUBSCRIPTION(nice_view_hid_pages, zmk_activity_state_changed);
+
+#if DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT)
+
+static int on_page_binding_pressed(struct zmk_behavior_binding *binding,
+                                   struct zmk_behavior_binding_event event) {
+    next_page();
+    return ZMK_BEHAVIOR_OPAQUE;
+}
+
+static int on_page_binding_released(struct zmk_behavior_binding *binding,
+                                    struct zmk_behavior_binding_event event) {
+    return ZMK_BEHAVIOR_OPAQUE;
+}
+
+static const struct behavior_driver_api behavior_nice_view_hid_page_driver_api = {
+    .binding_pressed = on_page_binding_pressed,
+    .binding_released = on_page_binding_released,
+};
+
+static int behavior_nice_view_hid_page_init(const struct device *dev) { return 0; }
+
+BEHAVIOR_DT_INST_DEFINE(0, behavior_nice_view_hid_page_init, NULL, NULL, NULL, POST_KERNEL,
+                        CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+                        &behavior_nice_view_hid_page_driver_api);
+
+#endif // DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT)
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2023 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <nice_view_hid/relay_frame.h>
+
+#include <string.h>
+
+#define RELAY_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+uint8_t relay_changed_scalars(const struct relay_state *a, const struct relay_state *b) {
+    uint8_t mask = 0;
+
+    if (a->is_connected != b->is_connected) {
+        mask |= RELAY_CONNECTED;
+    }
+    if (a->hour != b->hour || a->minute != b->minute) {
+        mask |= RELAY_TIME;
+    }
+    if (a->volume != b->volume) {
+        mask |= RELAY_VOLUME;
+    }
+    if (a->layout != b->layout) {
+        mask |= RELAY_LAYOUT;
+    }
+
+    return mask;
+}
+
+void relay_encode_scalars(uint8_t frame[RELAY_FRAME_SIZE], const struct relay_state *state,
+                          uint8_t mask) {
+    uint8_t *value = &frame[2];
+
+    memset(frame, 0, RELAY_FRAME_SIZE);
+    frame[0] = RELAY_HEADER(RELAY_SCALARS, 0);
+    frame[1] = mask;
+
+    if (mask & RELAY_CONNECTED) {
+        *value++ = state->is_connected;
+    }
+    if (mask & RELAY_TIME) {
+        *value++ = state->hour;
+        *value++ = state->minute;
+    }
+    if (mask & RELAY_VOLUME) {
+        *value++ = state->volume;
+    }
+    if (mask & RELAY_LAYOUT) {
+        *value++ = state->layout;
+    }
+}
+
+uint8_t relay_last_chunk(const char *str) {
+    size_t len = strnlen(str, RELAY_STR_LEN - 1);
+    return len / RELAY_CHUNK_SIZE;
+}
+
+bool relay_chunk_needed(const char *str, const char *sent, uint8_t chunk) {
+    size_t offset = chunk * RELAY_CHUNK_SIZE;
+
+    if (chunk == relay_last_chunk(str)) {
+        return true;
+    }
+    return offset < RELAY_STR_LEN &&
+           memcmp(&str[offset], &sent[offset],
+                  RELAY_MIN(RELAY_CHUNK_SIZE, RELAY_STR_LEN - offset)) != 0;
+}
+
+void relay_encode_chunk(uint8_t frame[RELAY_FRAME_SIZE], enum relay_frame_kind kind,
+                        const char *str, uint8_t chunk) {
+    size_t offset = chunk * RELAY_CHUNK_SIZE;
+
+    memset(frame, 0, RELAY_FRAME_SIZE);
+    frame[0] = RELAY_HEADER(kind, chunk);
+    frame[1] = strnlen(str, RELAY_STR_LEN - 1);
+    if (offset < RELAY_STR_LEN) {
+        memcpy(&frame[2], &str[offset], RELAY_MIN(RELAY_CHUNK_SIZE, RELAY_STR_LEN - offset));
+    }
+}
+
+uint8_t relay_decode_scalars(const uint8_t frame[RELAY_FRAME_SIZE], struct relay_state *state) {
+    uint8_t mask = frame[1];
+    const uint8_t *value = &frame[2];
+
+    if (mask & RELAY_CONNECTED) {
+        state->is_connected = *value++;
+    }
+    if (mask & RELAY_TIME) {
+        state->hour = *value++;
+        state->minute = *value++;
+    }
+    if (mask & RELAY_VOLUME) {
+        state->volume = *value++;
+    }
+    if (mask & RELAY_LAYOUT) {
+        state->layout = *value++;
+    }
+
+    return mask;
+}
+
+bool relay_decode_chunk(char *dst, const uint8_t frame[RELAY_FRAME_SIZE]) {
+    uint8_t chunk = RELAY_HEADER_CHUNK(frame[0]);
+    uint8_t len = RELAY_MIN(frame[1], RELAY_STR_LEN - 1);
+    size_t offset = chunk * RELAY_CHUNK_SIZE;
+
+    if (offset >= RELAY_STR_LEN) {
+        return false;
+    }
+
+    memcpy(&dst[offset], &frame[2], RELAY_MIN(RELAY_CHUNK_SIZE, RELAY_STR_LEN - offset));
+    if (chunk != len / RELAY_CHUNK_SIZE) {
+        return false;
+    }
+
+    dst[len] = '\0';
+    return true;
+}
@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2023 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <nice_view_hid/hid.h>
+#include <nice_view_hid/tiles.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <zmk/display.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+ZMK_EVENT_IMPL(image_notification);
+
+// _IMAGE reports: [_IMAGE, op, id_lo, id_hi, ...]
+//
+//   TILE_BEGIN  [width, height]   start receiving image `id`
+//   TILE_DATA   [len, bytes...]   next chunk of RLE data for the image being received
+//   TILE_SHOW   []                show image `id`, replies TILE_MISS if it is not cached
+//   TILE_CLEAR  []                hide the image
+//
+// Image data is 1-bpp, rows padded to whole bytes, MSB first. It is RLE compressed with
+// a control byte: 0x00-0x7F copies the next (n + 1) bytes literally, 0x80-0xFF repeats the
+// next byte (n - 0x80 + 2) times. Decoding happens as chunks arrive, into a scratch tile that
+// is copied into the cache once complete.
+//
+// LVGL draws cached images on the display work queue, so reports are handed over through a
+// message queue and the cache is only ever touched on that queue.
+enum tile_op {
+    TILE_BEGIN = 0,
+    TILE_DATA,
+    TILE_SHOW,
+    TILE_CLEAR,
+    TILE_MISS,
+};
+
+#define TILE_HEADER_SIZE 4
+#define TILE_PALETTE_SIZE 8
+#define TILE_STRIDE(w) (((w) + 7) / 8)
+#define TILE_BUF_SIZE (TILE_PALETTE_SIZE + TILE_STRIDE(TILE_MAX_SIZE) * TILE_MAX_SIZE)
+#define TILE_REPORT_QUEUE 4
+
+struct tile {
+    uint16_t id;
+    bool valid;
+    uint32_t last_used;
+    lv_img_dsc_t img;
+    uint8_t buf[TILE_BUF_SIZE];
+};
+
+struct tile_cache_stats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t decoded_bytes;
+    uint32_t decode_cycles;
+};
+
+static struct tile tiles[CONFIG_NICE_VIEW_HID_TILE_CACHE_SIZE];
+static uint32_t use_counter;
+static struct tile_cache_stats stats;
+
+// tile currently on screen, only evicted by a single-entry cache
+static struct tile *shown;
+
+// image being received, never on screen
+static struct tile incoming;
+
+K_MSGQ_DEFINE(tile_reports, HID_REPORT_SIZE, TILE_REPORT_QUEUE, 4);
+// a report didn't fit in the queue, the image being received is incomplete
+static atomic_t reports_dropped;
+
+static void tile_work_cb(struct k_work *work);
+
+static K_WORK_DEFINE(tile_work, tile_work_cb);
+
+static struct {
+    struct tile *tile;
+    size_t pos;
+    size_t size;
+    uint8_t literal;
+    uint8_t run;
+    bool show_when_done;
+} decoder;
+
+static const uint8_t palette[TILE_PALETTE_SIZE] = {
+#if IS_ENABLED(CONFIG_NICE_VIEW_HID_INVERTED)
+    0x00, 0x00, 0x00, 0xff, /*Color of index 0*/
+    0xff, 0xff, 0xff, 0xff, /*Color of index 1*/
+#else
+    0xff, 0xff, 0xff, 0xff, /*Color of index 0*/
+    0x00, 0x00, 0x00, 0xff, /*Color of index 1*/
+#endif
+};
+
+static struct tile *tile_find(uint16_t id) {
+    for (int i = 0; i < ARRAY_SIZE(tiles); i++) {
+        if (tiles[i].valid && tiles[i].id == id) {
+            return &tiles[i];
+        }
+    }
+    return NULL;
+}
+
+static struct tile *tile_evict(void) {
+    struct tile *victim = NULL;
+
+    for (int i = 0; i < ARRAY_SIZE(tiles); i++) {
+        struct tile *tile = &tiles[i];
+        if (tile == shown) {
+            continue;
+        }
+        if (!tile->valid) {
+            return tile;
+        }
+        if (victim == NULL || tile->last_used < victim->last_used) {
+            victim = tile;
+        }
+    }
+
+    // a single-entry cache has to give up the shown tile
+    return victim != NULL ? victim : &tiles[0];
+}
+
+static void tile_send_miss(uint16_t id) {
+    uint8_t reply[TILE_HEADER_SIZE] = {_IMAGE, TILE_MISS};
+    sys_put_le16(id, &reply[2]);
+    nice_view_hid_send(reply, sizeof(reply));
+}
+
+static void tile_hide(void) {
+    shown = NULL;
+    raise_image_notification((struct image_notification){.visible = false});
+}
+
+static void tile_show(struct tile *tile) {
+    tile->last_used = ++use_counter;
+    shown = tile;
+    raise_image_notification((struct image_notification){.visible = true, .id = tile->id});
+}
+
+static void tile_begin(uint16_t id, uint8_t width, uint8_t height) {
+    if (width == 0 || height == 0 || width > TILE_MAX_SIZE || height > TILE_MAX_SIZE) {
+        LOG_WRN("tile %u has invalid size %ux%u", id, width, height);
+        decoder.tile = NULL;
+        return;
+    }
+
+    struct tile *tile = &incoming;
+
+    tile->id = id;
+    tile->valid = false;
+    memcpy(tile->buf, palette, TILE_PALETTE_SIZE);
+
+    tile->img.header.cf = LV_IMG_CF_INDEXED_1BIT;
+    tile->img.header.always_zero = 0;
+    tile->img.header.reserved = 0;
+    tile->img.header.w = width;
+    tile->img.header.h = height;
+    tile->img.data_size = TILE_PALETTE_SIZE + TILE_STRIDE(width) * height;
+    tile->img.data = tile->buf;
+
+    decoder.tile = tile;
+    decoder.pos = TILE_PALETTE_SIZE;
+    decoder.size = tile->img.data_size;
+    decoder.literal = 0;
+    decoder.run = 0;
+    decoder.show_when_done = false;
+}
+
+static void tile_decode(const uint8_t *src, size_t len) {
+    struct tile *tile = decoder.tile;
+    uint32_t start = k_cycle_get_32();
+
+    for (size_t i = 0; i < len && decoder.pos < decoder.size; i++) {
+        uint8_t byte = src[i];
+
+        if (decoder.literal > 0) {
+            tile->buf[decoder.pos++] = byte;
+            decoder.literal--;
+        } else if (decoder.run > 0) {
+            size_t count = MIN(decoder.run, decoder.size - decoder.pos);
+            memset(&tile->buf[decoder.pos], byte, count);
+            decoder.pos += count;
+            decoder.run = 0;
+        } else if (byte & 0x80) {
+            decoder.run = (byte & 0x7F) + 2;
+        } else {
+            decoder.literal = byte + 1;
+        }
+    }
+
+    stats.decoded_bytes += len;
+    stats.decode_cycles += k_cycle_get_32() - start;
+
+    if (decoder.pos < decoder.size) {
+        return;
+    }
+
+    decoder.tile = NULL;
+
+    // a re-sent image replaces its old copy, otherwise the least recently used one
+    struct tile *slot = tile_find(tile->id);
+    if (slot == NULL) {
+        slot = tile_evict();
+    }
+    bool was_shown = slot == shown;
+    bool same_image = slot->valid && slot->id == tile->id;
+
+    memcpy(slot->buf, tile->buf, tile->img.data_size);
+    slot->id = tile->id;
+    slot->img = tile->img;
+    slot->img.data = slot->buf;
+    slot->valid = true;
+    slot->last_used = ++use_counter;
+
+    LOG_DBG("tile %u decoded, %u bytes in %u us so far, hits %u misses %u", slot->id,
+            stats.decoded_bytes, k_cyc_to_us_floor32(stats.decode_cycles), stats.hits,
+            stats.misses);
+
+    // raised again for an image on screen, so the widget picks up its new pixels
+    if (decoder.show_when_done || (was_shown && same_image)) {
+        tile_show(slot);
+    } else if (was_shown) {
+        tile_hide();
+    }
+}
+
+static void tile_apply(const uint8_t *data) {
+    uint8_t op = data[1];
+    uint16_t id = sys_get_le16(&data[2]);
+    const uint8_t *payload = &data[TILE_HEADER_SIZE];
+
+    switch (op) {
+    case TILE_BEGIN:
+        tile_begin(id, payload[0], payload[1]);
+        break;
+
+    case TILE_DATA:
+        if (decoder.tile != NULL && decoder.tile->id == id) {
+            tile_decode(&payload[1], MIN(payload[0], HID_REPORT_SIZE - TILE_HEADER_SIZE - 1));
+        }
+        break;
+
+    case TILE_SHOW: {
+        struct tile *tile = tile_find(id);
+        if (tile != NULL) {
+            stats.hits++;
+            tile_show(tile);
+        } else if (decoder.tile != NULL && decoder.tile->id == id) {
+            // still arriving, show it once complete
+            decoder.show_when_done = true;
+        } else {
+            stats.misses++;
+            tile_send_miss(id);
+        }
+        break;
+    }
+
+    case TILE_CLEAR:
+        tile_hide();
+        break;
+    }
+}
+
+static void tile_work_cb(struct k_work *work) {
+    uint8_t report[HID_REPORT_SIZE];
+
+    while (k_msgq_get(&tile_reports, report, K_NO_WAIT) == 0) {
+        tile_apply(report);
+    }
+
+    // the dropped report came after everything queued, so the image being received has a hole
+    if (atomic_cas(&reports_dropped, 1, 0) && decoder.tile != NULL) {
+        LOG_WRN("tile %u dropped, reports arrived too fast", decoder.tile->id);
+        tile_send_miss(decoder.tile->id);
+        decoder.tile = NULL;
+    }
+}
+
+void tile_cache_process(const uint8_t *data) {
+    if (k_msgq_put(&tile_reports, data, K_NO_WAIT) != 0) {
+        atomic_set(&reports_dropped, 1);
+    }
+    k_work_submit_to_queue(zmk_display_work_q(), &tile_work);
+}
+
+const lv_img_dsc_t *tile_cache_get(uint16_t id) {
+    struct tile *tile = tile_find(id);
+    return tile != NULL ? &tile->img : NULL;
+}
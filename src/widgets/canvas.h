@@ -0,0 +1,32 @@
+/*
+ *
+ * Copyright (c) 2023 The ZMK Contributors
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+// Geometry of the status screen canvases. Plain C, so the layout of the rotated buffers can be
+// checked on the host.
+
+#define CANVAS_SIZE 68
+#define SPARKLINE_SAMPLES 64
+
+// Canvases are drawn upright and rotated by 90 degrees around their centre (rotate_canvas), so
+// an upright point (x, y) ends up at this index of the buffer.
+#define CANVAS_ROTATED_INDEX(x, y) ((x) * CANVAS_SIZE + CANVAS_SIZE - 1 - (y))
+
+// graph frame in the upright top canvas, with a one pixel border
+#define SPARKLINE_FRAME_Y 21
+#define SPARKLINE_FRAME_H 42
+
+// graph area, inside the frame
+#define SPARKLINE_X 2
+#define SPARKLINE_Y 23
+#define SPARKLINE_H 38
+
+// A graph column is a contiguous run of one buffer row, from the bottom up: upright
+// (SPARKLINE_X + x, SPARKLINE_Y + SPARKLINE_H - 1 - y) is at SPARKLINE_COLUMN(x) + y. New samples
+// can therefore be drawn without redrawing and rotating the canvas again.
+#define SPARKLINE_COLUMN(x) CANVAS_ROTATED_INDEX(SPARKLINE_X + (x), SPARKLINE_Y + SPARKLINE_H - 1)
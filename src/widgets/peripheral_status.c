@@ -0,0 +1,359 @@
+/*
+ *
+ * Copyright (c) 2023 The ZMK Contributors
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include <zephyr/kernel.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/battery.h>
+#include <zmk/display.h>
+#include <zmk/events/usb_conn_state_changed.h>
+#include <zmk/event_manager.h>
+#include <zmk/events/battery_state_changed.h>
+#include <zmk/split/bluetooth/peripheral.h>
+#include <zmk/events/split_peripheral_status_changed.h>
+#include <zmk/usb.h>
+
+#ifdef CONFIG_NICE_VIEW_HID_SPLIT_RELAY
+#include <nice_view_hid/hid.h>
+#endif
+
+#include "peripheral_status.h"
+
+LV_IMG_DECLARE(bolt);
+LV_IMG_DECLARE(mountains);
+
+static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
+
+struct peripheral_status_state {
+    bool connected;
+};
+
+#ifdef CONFIG_NICE_VIEW_HID_SPLIT_RELAY
+struct host_status_state {
+    bool connected;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t volume;
+    bool playing;
+};
+#endif
+
+// Strips are drawn in logical coordinates, x along and y down from the top of the rotated
+// screen, and written straight into the packed buffer. Only the pixels that changed are touched
+// and only their area is invalidated, so a battery update doesn't redraw the whole screen.
+#define BATTERY_W 34
+#define BATTERY_H 18
+#define SYMBOL_X 40
+// volume bar along the bottom of the host strip, below the time
+#define VOLUME_Y (STRIP_HEIGHT - 2)
+
+static void set_px(struct status_strip *strip, int x, int y, bool on) {
+    if (x < 0 || x >= CANVAS_SIZE || y < 0 || y >= STRIP_HEIGHT) {
+        return;
+    }
+
+    int col = STRIP_HEIGHT - 1 - y;
+    uint8_t *byte = &strip->cbuf[STRIP_PALETTE_SIZE + x * STRIP_STRIDE + col / 8];
+    uint8_t bit = BIT(7 - col % 8);
+
+    *byte = on ? (*byte | bit) : (*byte & ~bit);
+}
+
+static void fill_rect(struct status_strip *strip, int x, int y, int w, int h, bool on) {
+    for (int i = x; i < x + w; i++) {
+        for (int j = y; j < y + h; j++) {
+            set_px(strip, i, j, on);
+        }
+    }
+}
+
+static void invalidate_rect(struct status_strip *strip, int x, int y, int w, int h) {
+    lv_area_t area;
+    lv_obj_get_coords(strip->canvas, &area);
+
+    lv_coord_t left = area.x1;
+    lv_coord_t top = area.y1;
+    area.x1 = left + STRIP_HEIGHT - (y + h);
+    area.x2 = left + STRIP_HEIGHT - 1 - y;
+    area.y1 = top + x;
+    area.y2 = top + x + w - 1;
+
+    lv_obj_invalidate_area(strip->canvas, &area);
+}
+
+static void draw_bolt(struct status_strip *strip, int x, int y) {
+    // 2 bpp indexed: 1 is background, 2 is foreground, the rest is transparent
+    const uint8_t *pixels = bolt.data + 4 * sizeof(lv_color32_t);
+    int stride = (bolt.header.w * 2 + 7) / 8;
+
+    for (int j = 0; j < bolt.header.h; j++) {
+        for (int i = 0; i < bolt.header.w; i++) {
+            uint8_t index = (pixels[j * stride + i / 4] >> (6 - (i % 4) * 2)) & 0x3;
+            if (index == 1 || index == 2) {
+                set_px(strip, x + i, y + j, index == 2);
+            }
+        }
+    }
+}
+
+// draws a glyph at pen position x on the font's baseline and returns its advance
+static int draw_glyph(struct status_strip *strip, int x, uint32_t letter) {
+    const lv_font_t *font = &lv_font_montserrat_18;
+
+    lv_font_glyph_dsc_t glyph;
+    const uint8_t *bitmap = lv_font_get_glyph_bitmap(font, letter);
+    if (bitmap == NULL || !lv_font_get_glyph_dsc(font, &glyph, letter, 0)) {
+        return 0;
+    }
+
+    int x0 = x + glyph.ofs_x;
+    int y0 = font->line_height - font->base_line - glyph.box_h - glyph.ofs_y;
+    uint8_t mask = BIT(glyph.bpp) - 1;
+
+    for (int j = 0; j < glyph.box_h; j++) {
+        for (int i = 0; i < glyph.box_w; i++) {
+            uint32_t bit = (j * glyph.box_w + i) * glyph.bpp;
+            uint8_t value = (bitmap[bit / 8] >> (8 - glyph.bpp - bit % 8)) & mask;
+            if (value > mask / 2) {
+                set_px(strip, x0 + i, y0 + j, true);
+            }
+        }
+    }
+
+    return glyph.adv_w;
+}
+
+// right aligned at the end of the strip
+static void draw_symbol(struct status_strip *strip, const char *symbol) {
+    uint32_t letter = _lv_txt_encoded_next(symbol, NULL);
+    draw_glyph(strip, CANVAS_SIZE - lv_font_get_glyph_width(&lv_font_montserrat_18, letter, 0),
+               letter);
+}
+
+static void draw_battery_strip(struct zmk_widget_status *widget) {
+    struct status_strip *strip = &widget->strip;
+    const struct status_state *state = &widget->state;
+
+    // same shape as draw_battery() in util.c
+    fill_rect(strip, 0, 0, BATTERY_W, BATTERY_H, false);
+    fill_rect(strip, 0, 2, 29, 12, true);
+    fill_rect(strip, 1, 3, 27, 10, false);
+    fill_rect(strip, 2, 4, (state->battery + 2) / 4, 8, true);
+    fill_rect(strip, 30, 5, 3, 6, true);
+    fill_rect(strip, 31, 6, 1, 4, false);
+
+    if (state->charging) {
+        draw_bolt(strip, 9, -1);
+    }
+
+    invalidate_rect(strip, 0, 0, BATTERY_W, BATTERY_H);
+}
+
+static void draw_connection_strip(struct zmk_widget_status *widget) {
+    struct status_strip *strip = &widget->strip;
+
+    fill_rect(strip, SYMBOL_X, 0, CANVAS_SIZE - SYMBOL_X, STRIP_HEIGHT, false);
+    draw_symbol(strip, widget->state.connected ? LV_SYMBOL_WIFI : LV_SYMBOL_CLOSE);
+    invalidate_rect(strip, SYMBOL_X, 0, CANVAS_SIZE - SYMBOL_X, STRIP_HEIGHT);
+}
+
+#ifdef CONFIG_NICE_VIEW_HID_SPLIT_RELAY
+// host time, a note while media is playing and the volume, as relayed by the central
+static void draw_host_strip(struct zmk_widget_status *widget) {
+    struct status_strip *strip = &widget->host;
+    const struct status_state *state = &widget->state;
+
+    fill_rect(strip, 0, 0, CANVAS_SIZE, STRIP_HEIGHT, false);
+
+    if (state->host_connected) {
+        char time[6];
+        snprintf(time, sizeof(time), "%02u:%02u", state->hour, state->minute);
+
+        int x = 0;
+        for (const char *c = time; *c != '\0'; c++) {
+            x += draw_glyph(strip, x, *c);
+        }
+        if (state->playing) {
+            draw_symbol(strip, LV_SYMBOL_AUDIO);
+        }
+        fill_rect(strip, 0, VOLUME_Y, MIN(state->volume, 100) * CANVAS_SIZE / 100, 2, true);
+    } else {
+        draw_symbol(strip, LV_SYMBOL_CLOSE);
+    }
+
+    invalidate_rect(strip, 0, 0, CANVAS_SIZE, STRIP_HEIGHT);
+}
+#endif
+
+static void set_battery_status(struct zmk_widget_status *widget,
+                               struct battery_status_state state) {
+#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
+    bool charging = state.usb_present;
+#else
+    bool charging = false;
+#endif
+    if (widget->state.battery == state.level && widget->state.charging == charging) {
+        return;
+    }
+
+    widget->state.charging = charging;
+    widget->state.battery = state.level;
+
+    draw_battery_strip(widget);
+}
+
+static void battery_status_update_cb(struct battery_status_state state) {
+    struct zmk_widget_status *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_battery_status(widget, state); }
+}
+
+static struct battery_status_state battery_status_get_state(const zmk_event_t *eh) {
+    const struct zmk_battery_state_changed *ev = as_zmk_battery_state_changed(eh);
+
+    return (struct battery_status_state){
+        .level = (ev != NULL) ? ev->state_of_charge : zmk_battery_state_of_charge(),
+#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
+        .usb_present = zmk_usb_is_powered(),
+#endif /* IS_ENABLED(CONFIG_USB_DEVICE_STACK) */
+    };
+}
+
+ZMK_DISPLAY_WIDGET_LISTENER(widget_battery_status, struct battery_status_state,
+                            battery_status_update_cb, battery_status_get_state)
+
+ZMK_SUBSCRIPTION(widget_battery_status, zmk_battery_state_changed);
+#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
+ZMK_SUBSCRIPTION(widget_battery_status, zmk_usb_conn_state_changed);
+#endif /* IS_ENABLED(CONFIG_USB_DEVICE_STACK) */
+
+static struct peripheral_status_state get_state(const zmk_event_t *_eh) {
+    return (struct peripheral_status_state){.connected = zmk_split_bt_peripheral_is_connected()};
+}
+
+static void set_connection_status(struct zmk_widget_status *widget,
+                                  struct peripheral_status_state state) {
+    if (widget->state.connected == state.connected) {
+        return;
+    }
+
+    widget->state.connected = state.connected;
+
+    draw_connection_strip(widget);
+}
+
+static void output_status_update_cb(struct peripheral_status_state state) {
+    struct zmk_widget_status *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_connection_status(widget, state); }
+}
+
+ZMK_DISPLAY_WIDGET_LISTENER(widget_peripheral_status, struct peripheral_status_state,
+                            output_status_update_cb, get_state)
+ZMK_SUBSCRIPTION(widget_peripheral_status, zmk_split_peripheral_status_changed);
+
+#ifdef CONFIG_NICE_VIEW_HID_SPLIT_RELAY
+// Each relayed notification carries one field, so they are merged here. The listener holds
+// its mutex while this runs, which keeps the merged copy consistent.
+static struct host_status_state get_host_state(const zmk_event_t *eh) {
+    static struct host_status_state host;
+
+    const struct is_connected_notification *conn = as_is_connected_notification(eh);
+    if (conn) {
+        host.connected = conn->value;
+    }
+
+    const struct time_notification *time = as_time_notification(eh);
+    if (time) {
+        host.hour = time->hour;
+        host.minute = time->minute;
+    }
+
+    const struct volume_notification *volume = as_volume_notification(eh);
+    if (volume) {
+        host.volume = volume->value;
+    }
+
+    const struct media_title_notification *title = as_media_title_notification(eh);
+    if (title) {
+        host.playing = title->title[0] != '\0';
+    }
+
+    return host;
+}
+
+static void host_status_update_cb(struct host_status_state host) {
+    struct zmk_widget_status *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) {
+        struct status_state *state = &widget->state;
+        if (state->host_connected == host.connected && state->hour == host.hour &&
+            state->minute == host.minute && state->volume == host.volume &&
+            state->playing == host.playing) {
+            continue;
+        }
+
+        state->host_connected = host.connected;
+        state->hour = host.hour;
+        state->minute = host.minute;
+        state->volume = host.volume;
+        state->playing = host.playing;
+        draw_host_strip(widget);
+    }
+}
+
+ZMK_DISPLAY_WIDGET_LISTENER(widget_host_status, struct host_status_state, host_status_update_cb,
+                            get_host_state)
+ZMK_SUBSCRIPTION(widget_host_status, is_connected_notification);
+ZMK_SUBSCRIPTION(widget_host_status, time_notification);
+ZMK_SUBSCRIPTION(widget_host_status, volume_notification);
+ZMK_SUBSCRIPTION(widget_host_status, media_title_notification);
+#endif
+
+static void strip_init(struct status_strip *strip, lv_obj_t *parent, lv_coord_t x_ofs) {
+    memset(strip->cbuf, 0, sizeof(strip->cbuf));
+
+    strip->canvas = lv_canvas_create(parent);
+    lv_obj_align(strip->canvas, LV_ALIGN_TOP_RIGHT, x_ofs, 0);
+    lv_canvas_set_buffer(strip->canvas, strip->cbuf, STRIP_HEIGHT, CANVAS_SIZE,
+                         LV_IMG_CF_INDEXED_1BIT);
+    lv_canvas_set_palette(strip->canvas, 0, LVGL_BACKGROUND);
+    lv_canvas_set_palette(strip->canvas, 1, LVGL_FOREGROUND);
+}
+
+int zmk_widget_status_init(struct zmk_widget_status *widget, lv_obj_t *parent) {
+    widget->obj = lv_obj_create(parent);
+    lv_obj_set_size(widget->obj, 160, 68);
+
+    memset(&widget->state, 0, sizeof(widget->state));
+
+    strip_init(&widget->strip, widget->obj, 0);
+
+    // static art is rendered straight from flash, it never needs a buffer
+    lv_obj_t *art = lv_img_create(widget->obj);
+    lv_img_set_src(art, &mountains);
+    lv_obj_align(art, LV_ALIGN_TOP_LEFT, 0, 0);
+
+#ifdef CONFIG_NICE_VIEW_HID_SPLIT_RELAY
+    // covers the right edge of the art, created after it so it is drawn on top
+    strip_init(&widget->host, widget->obj, -STRIP_HEIGHT);
+    draw_host_strip(widget);
+#endif
+
+    draw_battery_strip(widget);
+    draw_connection_strip(widget);
+
+    sys_slist_append(&widgets, &widget->node);
+    widget_battery_status_init();
+    widget_peripheral_status_init();
+#ifdef CONFIG_NICE_VIEW_HID_SPLIT_RELAY
+    widget_host_status_init();
+#endif
+
+    return 0;
+}
+
+lv_obj_t *zmk_widget_status_obj(struct zmk_widget_status *widget) { return widget->obj; }
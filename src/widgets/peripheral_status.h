@@ -0,0 +1,37 @@
+/*
+ *
+ * Copyright (c) 2023 The ZMK Contributors
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <zephyr/kernel.h>
+#include "util.h"
+
+// battery and connection strip along the top of the (rotated) screen
+#define STRIP_HEIGHT 24
+#define STRIP_STRIDE ((STRIP_HEIGHT + 7) / 8)
+#define STRIP_PALETTE_SIZE (2 * sizeof(lv_color32_t))
+
+struct status_strip {
+    lv_obj_t *canvas;
+    // 1 bpp indexed, drawn in place instead of being rotated after every change
+    uint8_t cbuf[STRIP_PALETTE_SIZE + STRIP_STRIDE * CANVAS_SIZE];
+};
+
+struct zmk_widget_status {
+    sys_snode_t node;
+    lv_obj_t *obj;
+    struct status_strip strip;
+#ifdef CONFIG_NICE_VIEW_HID_SPLIT_RELAY
+    // host state relayed by the central
+    struct status_strip host;
+#endif
+    struct status_state state;
+};
+
+int zmk_widget_status_init(struct zmk_widget_status *widget, lv_obj_t *parent);
+lv_obj_t *zmk_widget_status_obj(struct zmk_widget_status *widget);
@@ -13,6 +13,7 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #include <zmk/battery.h>
 #include <zmk/display.h>
 #include "status.h"
+#include "update_queue.h"
 #include <zmk/events/usb_conn_state_changed.h>
 #include <zmk/event_manager.h>
 #include <zmk/events/battery_state_changed.h>
@@ -26,23 +27,25 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #ifdef CONFIG_RAW_HID
 #include <nice_view_hid/hid.h>
 #endif
+#ifdef CONFIG_NICE_VIEW_HID_TILES
+#include <nice_view_hid/tiles.h>
+#endif
+#include <nice_view_hid/glyphs.h>
+#ifdef CONFIG_NICE_VIEW_HID_PAGES
+#include <nice_view_hid/pages.h>
+#endif
+#ifdef CONFIG_NICE_VIEW_HID_FLOW_CONTROL
+#include <nice_view_hid/flow.h>
+#endif
 
-// Media widget only on PERIPHERAL
-#if !defined(CONFIG_ZMK_SPLIT_ROLE_CENTRAL) && defined(CONFIG_NICE_VIEW_HID_MEDIA_INFO)
+// Raw HID reports arrive on the central, so media info is shown there
+#if defined(CONFIG_RAW_HID) && defined(CONFIG_NICE_VIEW_HID_MEDIA_INFO)
+#define NOWPLAY_WIDGET
 #define NOWPLAY_Y_OFFSET 20
 #define NOWPLAY_SCROLL_SPEED 10 //scroll speed in px/s
-// forward declarations
-static void title_update_cb(struct media_title_notification notif);
-static void artist_update_cb(struct media_artist_notification notif);
-static void media_conn_update_cb(struct is_connected_notification conn);
 #endif
 
-enum widget_children {
-    WIDGET_TOP = 0,
-    WIDGET_HID,
-    WIDGET_MIDDLE,
-    WIDGET_BOTTOM,
-};
+#define STATUS_LINE_WIDTH (IS_ENABLED(CONFIG_NICE_VIEW_HID_TILES) ? 160 - 34 : 160)
 
 static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
 
@@ -58,12 +61,127 @@ struct layer_status_state {
     const char *label;
 };
 
-#if !defined(CONFIG_NICE_VIEW_HID_MEDIA_INFO)
+// Parts of the state a widget can subscribe to
+enum status_update {
+    UPDATE_BATTERY = BIT(0),
+    UPDATE_OUTPUT = BIT(1),
+    UPDATE_LAYER = BIT(2),
+    UPDATE_HID = BIT(3),
+    UPDATE_MEDIA = BIT(4),
+    // new host glyphs arrived, redraw anything showing host provided text
+    UPDATE_TEXT = BIT(5),
+    UPDATE_ART = BIT(6),
+};
+
+// Every part of the screen is described by an entry in status_widgets. The table is selected at
+// compile time, so only enabled widgets are compiled and allocated, init walks the table, and
+// state changes only redraw the widgets subscribed to them.
+//
+// Widgets belong to a page. Only the visible page has LVGL objects, they are created when the
+// page is shown and deleted when it is hidden. Hidden pages keep receiving state updates, which
+// are drawn once the page is shown again. Only the stock page draws to canvases, the media page
+// is built from labels and an image, so it adds no canvas buffers.
+struct status_widget_desc {
+    uint8_t page;
+    // canvas buffer index, or -1 for widgets built from LVGL objects
+    int8_t canvas;
+    lv_align_t align;
+    lv_coord_t x_ofs;
+    uint8_t updates;
+    void (*create)(struct zmk_widget_status *widget, const struct status_widget_desc *desc);
+    void (*draw)(struct zmk_widget_status *widget);
+};
+
+static const char *output_symbol(const struct status_state *state) {
+    switch (state->selected_endpoint.transport) {
+    case ZMK_TRANSPORT_USB:
+        return LV_SYMBOL_USB;
+    case ZMK_TRANSPORT_BLE:
+        if (state->active_profile_bonded) {
+            if (state->active_profile_connected) {
+                return LV_SYMBOL_WIFI;
+            } else {
+                return LV_SYMBOL_CLOSE;
+            }
+        } else {
+            return LV_SYMBOL_SETTINGS;
+        }
+    }
+    return "";
+}
+
+#if STATUS_PAGE_STOCK
+
+// ---- Stock page ----
+
+static void create_canvas(struct zmk_widget_status *widget, const struct status_widget_desc *desc) {
+    lv_obj_t *canvas = lv_canvas_create(widget->page_obj);
+    lv_obj_align(canvas, desc->align, desc->x_ofs, 0);
+    lv_canvas_set_buffer(canvas, widget->cbuf[desc->canvas], CANVAS_SIZE, CANVAS_SIZE,
+                         LV_IMG_CF_TRUE_COLOR);
+    widget->canvas[desc->canvas] = canvas;
+}
+
+#ifdef CONFIG_NICE_VIEW_HID_SPARKLINE
+// cycles spent on the graph: a new sample shifts it in place, other updates redraw and rotate
+// the whole top canvas
+static struct {
+    uint32_t shifts;
+    uint32_t shift_cycles;
+    uint32_t redraws;
+    uint32_t redraw_cycles;
+} sparkline_timing;
+
+static void draw_sparkline_column(lv_color_t cbuf[], int x, uint8_t value) {
+    lv_color_t *column = &cbuf[SPARKLINE_COLUMN(x)];
+    int height = MIN(value, 100) * SPARKLINE_H / 100;
+
+    // column[0] is the bottom of the graph
+    for (int y = 0; y < SPARKLINE_H; y++) {
+        column[y] = y < height ? (LVGL_FOREGROUND) : (LVGL_BACKGROUND);
+    }
+}
+
+static void draw_sparkline(lv_color_t cbuf[], const struct status_state *state) {
+    for (int x = 0; x < SPARKLINE_SAMPLES; x++) {
+        draw_sparkline_column(cbuf, x, state->metric[(state->metric_head + x) % SPARKLINE_SAMPLES]);
+    }
+}
+
+static void shift_sparkline(struct zmk_widget_status *widget) {
+    lv_color_t *cbuf = widget->cbuf[CANVAS_TOP];
+    const struct status_state *state = &widget->state;
+    uint32_t start = k_cycle_get_32();
+
+    for (int x = 0; x < SPARKLINE_SAMPLES - 1; x++) {
+        memcpy(&cbuf[SPARKLINE_COLUMN(x)], &cbuf[SPARKLINE_COLUMN(x + 1)],
+               SPARKLINE_H * sizeof(lv_color_t));
+    }
 
-// ---- All draw_* and set_* functions and their update callbacks ----
+    uint8_t newest = (state->metric_head + SPARKLINE_SAMPLES - 1) % SPARKLINE_SAMPLES;
+    draw_sparkline_column(cbuf, SPARKLINE_SAMPLES - 1, state->metric[newest]);
 
-static void draw_top(lv_obj_t *widget, lv_color_t cbuf[], const struct status_state *state) {
-    lv_obj_t *canvas = lv_obj_get_child(widget, WIDGET_TOP);
+    sparkline_timing.shift_cycles += k_cycle_get_32() - start;
+    sparkline_timing.shifts++;
+    LOG_DBG("sparkline: shift %u us avg over %u, top redraw %u us avg over %u",
+            k_cyc_to_us_floor32(sparkline_timing.shift_cycles / sparkline_timing.shifts),
+            sparkline_timing.shifts,
+            sparkline_timing.redraws > 0
+                ? k_cyc_to_us_floor32(sparkline_timing.redraw_cycles / sparkline_timing.redraws)
+                : 0,
+            sparkline_timing.redraws);
+
+    lv_obj_invalidate(widget->canvas[CANVAS_TOP]);
+}
+#endif
+
+static void draw_top(struct zmk_widget_status *widget) {
+    lv_obj_t *canvas = widget->canvas[CANVAS_TOP];
+    lv_color_t *cbuf = widget->cbuf[CANVAS_TOP];
+    const struct status_state *state = &widget->state;
+#ifdef CONFIG_NICE_VIEW_HID_SPARKLINE
+    uint32_t start = k_cycle_get_32();
+#endif
 
     lv_draw_label_dsc_t label_dsc;
     init_label_dsc(&label_dsc, LVGL_FOREGROUND, &lv_font_montserrat_18, LV_TEXT_ALIGN_RIGHT);
@@ -77,40 +195,41 @@ static void draw_top(lv_obj_t *widget, lv_color_t cbuf[], const struct status_st
     draw_battery(canvas, state);
 
     // Draw output status
-    char output_text[10] = {};
-
-    switch (state->selected_endpoint.transport) {
-    case ZMK_TRANSPORT_USB:
-        strcat(output_text, LV_SYMBOL_USB);
-        break;
-    case ZMK_TRANSPORT_BLE:
-        if (state->active_profile_bonded) {
-            if (state->active_profile_connected) {
-                strcat(output_text, LV_SYMBOL_WIFI);
-            } else {
-                strcat(output_text, LV_SYMBOL_CLOSE);
-            }
-        } else {
-            strcat(output_text, LV_SYMBOL_SETTINGS);
-        }
-        break;
-    }
+    lv_canvas_draw_text(canvas, 0, 0, CANVAS_SIZE, &label_dsc, output_symbol(state));
 
-    lv_canvas_draw_text(canvas, 0, 0, CANVAS_SIZE, &label_dsc, output_text);
+#ifdef CONFIG_NICE_VIEW_HID_SPARKLINE
+    // Draw graph frame
+    lv_draw_rect_dsc_t rect_white_dsc;
+    init_rect_dsc(&rect_white_dsc, LVGL_FOREGROUND);
+    lv_canvas_draw_rect(canvas, 0, SPARKLINE_FRAME_Y, CANVAS_SIZE, SPARKLINE_FRAME_H,
+                        &rect_white_dsc);
+    lv_canvas_draw_rect(canvas, 1, SPARKLINE_FRAME_Y + 1, CANVAS_SIZE - 2, SPARKLINE_FRAME_H - 2,
+                        &rect_black_dsc);
+#endif
 
     // Rotate canvas
     rotate_canvas(canvas, cbuf);
+
+#ifdef CONFIG_NICE_VIEW_HID_SPARKLINE
+    // Graph is drawn straight into the rotated buffer
+    draw_sparkline(cbuf, state);
+
+    sparkline_timing.redraw_cycles += k_cycle_get_32() - start;
+    sparkline_timing.redraws++;
+#endif
 }
 
-static void draw_hid(lv_obj_t *widget, lv_color_t cbuf[], const struct status_state *state) {
-    lv_obj_t *canvas = lv_obj_get_child(widget, WIDGET_HID);
+static void draw_hid(struct zmk_widget_status *widget) {
+    lv_obj_t *canvas = widget->canvas[CANVAS_HID];
+    const struct status_state *state = &widget->state;
 
     lv_draw_rect_dsc_t rect_black_dsc;
     init_rect_dsc(&rect_black_dsc, LVGL_BACKGROUND);
     lv_draw_label_dsc_t label_time;
     init_label_dsc(&label_time, LVGL_FOREGROUND, &lv_font_montserrat_22, LV_TEXT_ALIGN_CENTER);
     lv_draw_label_dsc_t label_layout;
-    init_label_dsc(&label_layout, LVGL_FOREGROUND, &lv_font_montserrat_18, LV_TEXT_ALIGN_CENTER);
+    init_label_dsc(&label_layout, LVGL_FOREGROUND, glyph_font(&lv_font_montserrat_18),
+                   LV_TEXT_ALIGN_CENTER);
     lv_draw_label_dsc_t label_volume;
     init_label_dsc(&label_volume, LVGL_FOREGROUND, &lv_font_montserrat_18, LV_TEXT_ALIGN_CENTER);
 
@@ -147,11 +266,7 @@ static void draw_hid(lv_obj_t *widget, lv_color_t cbuf[], const struct status_st
 
         char volume[10] = {};
         sprintf(volume, "vol: %i", state->volume);
-#if defined(CONFIG_NICE_VIEW_HID_MEDIA_INFO)
-// skip drawing volume when media is shown
-#else
         lv_canvas_draw_text(canvas, 0, 50 - TEXT_OFFSET_Y, 68, &label_volume, volume);
-#endif
     } else
 #endif
     {
@@ -161,11 +276,12 @@ static void draw_hid(lv_obj_t *widget, lv_color_t cbuf[], const struct status_st
     }
 
     // Rotate canvas
-    rotate_canvas(canvas, cbuf);
+    rotate_canvas(canvas, widget->cbuf[CANVAS_HID]);
 }
 
-static void draw_middle(lv_obj_t *widget, lv_color_t cbuf[], const struct status_state *state) {
-    lv_obj_t *canvas = lv_obj_get_child(widget, WIDGET_MIDDLE);
+static void draw_middle(struct zmk_widget_status *widget) {
+    lv_obj_t *canvas = widget->canvas[CANVAS_MIDDLE];
+    const struct status_state *state = &widget->state;
 
     lv_draw_rect_dsc_t rect_black_dsc;
     init_rect_dsc(&rect_black_dsc, LVGL_BACKGROUND);
@@ -213,23 +329,22 @@ static void draw_middle(lv_obj_t *widget, lv_color_t cbuf[], const struct status
 #endif
 
     // Rotate canvas
-    rotate_canvas(canvas, cbuf);
+    rotate_canvas(canvas, widget->cbuf[CANVAS_MIDDLE]);
 }
 
-static void draw_bottom(lv_obj_t *widget, lv_color_t cbuf[], const struct status_state *state) {
-    lv_obj_t *canvas = lv_obj_get_child(widget, WIDGET_BOTTOM);
+static void draw_bottom(struct zmk_widget_status *widget) {
+    lv_obj_t *canvas = widget->canvas[CANVAS_BOTTOM];
+    const struct status_state *state = &widget->state;
 
     lv_draw_rect_dsc_t rect_black_dsc;
     init_rect_dsc(&rect_black_dsc, LVGL_BACKGROUND);
     lv_draw_label_dsc_t label_dsc;
-    init_label_dsc(&label_dsc, LVGL_FOREGROUND, &lv_font_montserrat_18, LV_TEXT_ALIGN_CENTER);
+    init_label_dsc(&label_dsc, LVGL_FOREGROUND, glyph_font(&lv_font_montserrat_18),
+                   LV_TEXT_ALIGN_CENTER);
 
     // Fill background
     lv_canvas_draw_rect(canvas, 0, 0, CANVAS_SIZE, CANVAS_SIZE, &rect_black_dsc);
 
-#if defined(CONFIG_NICE_VIEW_HID_MEDIA_INFO)
-// skip drawing layer when media is shown
-#else
     // Draw layer
     if (state->layer_label == NULL || strlen(state->layer_label) == 0) {
         char text[10] = {};
@@ -238,19 +353,307 @@ static void draw_bottom(lv_obj_t *widget, lv_color_t cbuf[], const struct status
     } else {
         lv_canvas_draw_text(canvas, 0, 5, 68, &label_dsc, state->layer_label);
     }
-#endif
 
     // Rotate canvas
-    rotate_canvas(canvas, cbuf);
+    rotate_canvas(canvas, widget->cbuf[CANVAS_BOTTOM]);
+}
+
+#endif // STATUS_PAGE_STOCK
+
+#if STATUS_PAGE_MEDIA
+
+// ---- Media page ----
+
+// With CONFIG_NICE_VIEW_HID_STATIC_TEXT labels point at buffers that live in the widget or its
+// state instead of keeping a heap copy, so text updates don't allocate. Dots are written into
+// the text buffer itself, so labels clip long text instead.
+#ifdef CONFIG_NICE_VIEW_HID_STATIC_TEXT
+#define LABEL_LONG_TRUNCATE LV_LABEL_LONG_CLIP
+#else
+#define LABEL_LONG_TRUNCATE LV_LABEL_LONG_DOT
+#endif
+
+static void set_label_text(lv_obj_t *label, const char *text) {
+#ifdef CONFIG_NICE_VIEW_HID_STATIC_TEXT
+    lv_label_set_text_static(label, text);
+#else
+    lv_label_set_text(label, text);
+#endif
+}
+
+static void create_status_line(struct zmk_widget_status *widget,
+                               const struct status_widget_desc *desc) {
+    widget->label_status = lv_label_create(widget->page_obj);
+    lv_obj_set_width(widget->label_status, STATUS_LINE_WIDTH);
+    lv_obj_set_style_text_font(widget->label_status, glyph_font(&lv_font_montserrat_12), 0);
+    lv_label_set_long_mode(widget->label_status, LABEL_LONG_TRUNCATE);
+    lv_obj_set_pos(widget->label_status, 0, 0);
+}
+
+static void draw_status_line(struct zmk_widget_status *widget) {
+    const struct status_state *state = &widget->state;
+
+    char layer[10] = {};
+    if (state->layer_label == NULL || strlen(state->layer_label) == 0) {
+        sprintf(layer, "LAYER %i", state->layer_index);
+    }
+
+#ifdef CONFIG_NICE_VIEW_HID_STATIC_TEXT
+    char *text = widget->text_status;
+#else
+    char text[STATUS_TEXT_SIZE];
+#endif
+    snprintf(text, STATUS_TEXT_SIZE, "%s%i%%  %s %i  %s", state->charging ? LV_SYMBOL_CHARGE : "",
+             state->battery, output_symbol(state), state->active_profile_index + 1,
+             layer[0] != '\0' ? layer : state->layer_label);
+    set_label_text(widget->label_status, text);
+}
+
+#ifdef NOWPLAY_WIDGET
+static void create_now_playing(struct zmk_widget_status *widget,
+                               const struct status_widget_desc *desc) {
+    // Now Playing header
+    widget->label_now = lv_label_create(widget->page_obj);
+    lv_obj_set_style_text_font(widget->label_now, &lv_font_montserrat_12, 0);
+    lv_label_set_text_static(widget->label_now, "Now Playing");
+    lv_obj_set_pos(widget->label_now, 0, NOWPLAY_Y_OFFSET);
+
+    // Track title (scrolling)
+    widget->label_track = lv_label_create(widget->page_obj);
+    lv_obj_set_width(widget->label_track, 160);
+    lv_obj_set_style_text_font(widget->label_track, glyph_font(&lv_font_montserrat_18), 0);
+    lv_label_set_long_mode(widget->label_track, LV_LABEL_LONG_SCROLL_CIRCULAR);
+    lv_obj_set_style_anim_speed(widget->label_track, NOWPLAY_SCROLL_SPEED, 0);
+    lv_obj_set_pos(widget->label_track, 0, NOWPLAY_Y_OFFSET + 12 + 4);
+
+    // Artist name
+    widget->label_artist = lv_label_create(widget->page_obj);
+    lv_obj_set_width(widget->label_artist, 160);
+    lv_obj_set_style_text_font(widget->label_artist, glyph_font(&lv_font_montserrat_12), 0);
+    lv_label_set_long_mode(widget->label_artist, LABEL_LONG_TRUNCATE);
+    lv_obj_set_pos(widget->label_artist, 0, NOWPLAY_Y_OFFSET + 12 + 4 + 18 + 2);
+}
+
+static void draw_now_playing(struct zmk_widget_status *widget) {
+    if (widget->state.track_title[0] == '\0') {
+        set_label_text(widget->label_track, "No media");
+        set_label_text(widget->label_artist, "");
+    } else {
+        set_label_text(widget->label_track, widget->state.track_title);
+        set_label_text(widget->label_artist, widget->state.track_artist);
+    }
+}
+
+#ifdef CONFIG_NICE_VIEW_HID_TILES
+static void create_art(struct zmk_widget_status *widget, const struct status_widget_desc *desc) {
+    // Host-pushed album art, top right above the title
+    widget->img_art = lv_img_create(widget->page_obj);
+    lv_obj_align(widget->img_art, LV_ALIGN_TOP_RIGHT, 0, 0);
+    lv_obj_add_flag(widget->img_art, LV_OBJ_FLAG_HIDDEN);
+}
+
+static void draw_art(struct zmk_widget_status *widget) {
+    const struct status_state *state = &widget->state;
+    const lv_img_dsc_t *img = state->art_visible ? tile_cache_get(state->art_id) : NULL;
+
+    if (img == NULL) {
+        lv_obj_add_flag(widget->img_art, LV_OBJ_FLAG_HIDDEN);
+        return;
+    }
+    // cache slots are reused, so the same descriptor may hold a new image
+    lv_img_cache_invalidate_src(img);
+    lv_img_set_src(widget->img_art, img);
+    lv_obj_clear_flag(widget->img_art, LV_OBJ_FLAG_HIDDEN);
+}
+#endif
+#endif // NOWPLAY_WIDGET
+
+#endif // STATUS_PAGE_MEDIA
+
+static const struct status_widget_desc status_widgets[] = {
+#if STATUS_PAGE_STOCK
+    {
+        .page = PAGE_STOCK,
+        .canvas = CANVAS_TOP,
+        .align = LV_ALIGN_TOP_RIGHT,
+        .x_ofs = 0,
+        .updates = UPDATE_BATTERY | UPDATE_OUTPUT,
+        .create = create_canvas,
+        .draw = draw_top,
+    },
+    {
+        .page = PAGE_STOCK,
+        .canvas = CANVAS_HID,
+        .align = LV_ALIGN_TOP_LEFT,
+        .x_ofs = 64,
+        .updates = UPDATE_HID | UPDATE_TEXT,
+        .create = create_canvas,
+        .draw = draw_hid,
+    },
+    {
+        .page = PAGE_STOCK,
+        .canvas = CANVAS_MIDDLE,
+        .align = LV_ALIGN_TOP_LEFT,
+        .x_ofs = -4,
+        .updates = UPDATE_OUTPUT,
+        .create = create_canvas,
+        .draw = draw_middle,
+    },
+    {
+        .page = PAGE_STOCK,
+        .canvas = CANVAS_BOTTOM,
+        .align = LV_ALIGN_TOP_LEFT,
+        .x_ofs = -44,
+        .updates = UPDATE_LAYER | UPDATE_TEXT,
+        .create = create_canvas,
+        .draw = draw_bottom,
+    },
+#endif
+#if STATUS_PAGE_MEDIA
+    {
+        .page = PAGE_MEDIA,
+        .canvas = -1,
+        .updates = UPDATE_BATTERY | UPDATE_OUTPUT | UPDATE_LAYER | UPDATE_TEXT,
+        .create = create_status_line,
+        .draw = draw_status_line,
+    },
+#ifdef NOWPLAY_WIDGET
+    {
+        .page = PAGE_MEDIA,
+        .canvas = -1,
+        .updates = UPDATE_MEDIA | UPDATE_TEXT,
+        .create = create_now_playing,
+        .draw = draw_now_playing,
+    },
+#ifdef CONFIG_NICE_VIEW_HID_TILES
+    {
+        .page = PAGE_MEDIA,
+        .canvas = -1,
+        .updates = UPDATE_ART,
+        .create = create_art,
+        .draw = draw_art,
+    },
+#endif
+#endif // NOWPLAY_WIDGET
+#endif // STATUS_PAGE_MEDIA
+};
+
+static void redraw(struct zmk_widget_status *widget, uint8_t updates) {
+    for (int i = 0; i < ARRAY_SIZE(status_widgets); i++) {
+        const struct status_widget_desc *desc = &status_widgets[i];
+        if (desc->page == widget->page && (desc->updates & updates) && desc->draw != NULL) {
+            desc->draw(widget);
+        }
+    }
 }
 
+static void show_page(struct zmk_widget_status *widget, uint8_t page) {
+    if (widget->page_obj != NULL) {
+        lv_obj_del(widget->page_obj);
+    }
+
+    widget->page = page;
+    widget->page_obj = lv_obj_create(widget->obj);
+    lv_obj_remove_style_all(widget->page_obj);
+    lv_obj_set_size(widget->page_obj, 160, 68);
+
+    for (int i = 0; i < ARRAY_SIZE(status_widgets); i++) {
+        if (status_widgets[i].page == page) {
+            status_widgets[i].create(widget, &status_widgets[i]);
+        }
+    }
+    redraw(widget, UINT8_MAX);
+}
+
+// ---- Update queue ----
+
+// Listeners don't each submit their own work to the display queue. Instead every listener owns
+// a category slot that holds only its latest state, so a burst of host reports collapses into
+// one pending update per category. A single work item drains the slots in category order:
+// keyboard state first, all of it on every run, then at most one host category before the
+// work is resubmitted. A flood of media or volume reports therefore never delays a layer,
+// battery or profile change by more than one host redraw.
+
+BUILD_ASSERT(QUEUE_COUNT <= 32, "pending categories have to fit in one atomic_t");
+
+static atomic_t queue_pending;
+static int64_t queued_at[QUEUE_COUNT];
+static int64_t max_keyboard_latency;
+
+static void queue_work_cb(struct k_work *work);
+static K_WORK_DEFINE(queue_work, queue_work_cb);
+
+static void queue_update(enum status_queue category) {
+    if (!(atomic_or(&queue_pending, BIT(category)) & BIT(category))) {
+        queued_at[category] = k_uptime_get();
+    }
+    k_work_submit_to_queue(zmk_display_work_q(), &queue_work);
+}
+
+// Same interface as ZMK_DISPLAY_WIDGET_LISTENER, but queued by category
+#define STATUS_LISTENER(listener, state_type, cb, state_func, category)                            \
+    K_MUTEX_DEFINE(listener##_mutex);                                                              \
+    static state_type __##listener##_state;                                                        \
+    static void listener##_refresh_state(const zmk_event_t *eh) {                                  \
+        k_mutex_lock(&listener##_mutex, K_FOREVER);                                                \
+        __##listener##_state = state_func(eh);                                                     \
+        k_mutex_unlock(&listener##_mutex);                                                         \
+    }                                                                                              \
+    static void listener##_apply(void) {                                                           \
+        k_mutex_lock(&listener##_mutex, K_FOREVER);                                                \
+        state_type state = __##listener##_state;                                                   \
+        k_mutex_unlock(&listener##_mutex);                                                         \
+        cb(state);                                                                                 \
+    }                                                                                              \
+    static void listener##_init(void) {                                                            \
+        listener##_refresh_state(NULL);                                                            \
+        listener##_apply();                                                                        \
+    }                                                                                              \
+    static int listener##_cb(const zmk_event_t *eh) {                                              \
+        if (zmk_display_is_initialized()) {                                                        \
+            listener##_refresh_state(eh);                                                          \
+            queue_update(category);                                                                \
+        }                                                                                          \
+        return ZMK_EV_EVENT_BUBBLE;                                                                \
+    }                                                                                              \
+    ZMK_LISTENER(listener, listener##_cb);
+
+// Like STATUS_LISTENER, but each event is merged into the pending state, which is reset once
+// applied. For events that can't be collapsed to the latest one, such as samples or steps.
+// merge_func returns false for events that don't change the pending state.
+#define STATUS_ACCUMULATOR(listener, state_type, cb, merge_func, category)                         \
+    K_MUTEX_DEFINE(listener##_mutex);                                                              \
+    static state_type __##listener##_state;                                                        \
+    static void listener##_apply(void) {                                                           \
+        k_mutex_lock(&listener##_mutex, K_FOREVER);                                                \
+        state_type state = __##listener##_state;                                                   \
+        __##listener##_state = (state_type){0};                                                    \
+        k_mutex_unlock(&listener##_mutex);                                                         \
+        cb(state);                                                                                 \
+    }                                                                                              \
+    static void listener##_init(void) { listener##_apply(); }                                      \
+    static int listener##_cb(const zmk_event_t *eh) {                                              \
+        if (zmk_display_is_initialized()) {                                                        \
+            k_mutex_lock(&listener##_mutex, K_FOREVER);                                            \
+            bool merged = merge_func(&__##listener##_state, eh);                                   \
+            k_mutex_unlock(&listener##_mutex);                                                     \
+            if (merged) {                                                                          \
+                queue_update(category);                                                            \
+            }                                                                                      \
+        }                                                                                          \
+        return ZMK_EV_EVENT_BUBBLE;                                                                \
+    }                                                                                              \
+    ZMK_LISTENER(listener, listener##_cb);
+
+// ---- Listeners ----
+
 static void set_battery_status(struct zmk_widget_status *widget,
                                struct battery_status_state state) {
 #if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
     widget->state.charging = state.usb_present;
 #endif
     widget->state.battery = state.level;
-    draw_top(widget->obj, widget->cbuf, &widget->state);
+    redraw(widget, UPDATE_BATTERY);
 }
 
 static void battery_status_update_cb(struct battery_status_state state) {
@@ -269,8 +672,8 @@ static struct battery_status_state battery_status_get_state(const zmk_event_t *e
     };
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_battery_status, struct battery_status_state,
-                            battery_status_update_cb, battery_status_get_state)
+STATUS_LISTENER(widget_battery_status, struct battery_status_state, battery_status_update_cb,
+                battery_status_get_state, QUEUE_BATTERY)
 
 ZMK_SUBSCRIPTION(widget_battery_status, zmk_battery_state_changed);
 #if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
@@ -284,8 +687,7 @@ static void set_output_status(struct zmk_widget_status *widget,
     widget->state.active_profile_connected = state->active_profile_connected;
     widget->state.active_profile_bonded = state->active_profile_bonded;
 
-    draw_top(widget->obj, widget->cbuf, &widget->state);
-    draw_middle(widget->obj, widget->cbuf2, &widget->state);
+    redraw(widget, UPDATE_OUTPUT);
 }
 
 static void output_status_update_cb(struct output_status_state state) {
@@ -302,8 +704,8 @@ static struct output_status_state output_status_get_state(const zmk_event_t *_eh
     };
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_output_status, struct output_status_state,
-                            output_status_update_cb, output_status_get_state)
+STATUS_LISTENER(widget_output_status, struct output_status_state, output_status_update_cb,
+                output_status_get_state, QUEUE_OUTPUT)
 ZMK_SUBSCRIPTION(widget_output_status, zmk_endpoint_changed);
 
 #if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
@@ -316,7 +718,7 @@ ZMK_SUBSCRIPTION(widget_output_status, zmk_ble_active_profile_changed);
 static void set_layer_status(struct zmk_widget_status *widget, struct layer_status_state state) {
     widget->state.layer_index = state.index;
     widget->state.layer_label = state.label;
-    draw_bottom(widget->obj, widget->cbuf3, &widget->state);
+    redraw(widget, UPDATE_LAYER);
 }
 
 static void layer_status_update_cb(struct layer_status_state state) {
@@ -330,13 +732,14 @@ static struct layer_status_state layer_status_get_state(const zmk_event_t *eh) {
         .index = index, .label = zmk_keymap_layer_name(zmk_keymap_layer_index_to_id(index))};
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_layer_status, struct layer_status_state, layer_status_update_cb,
-                            layer_status_get_state)
+STATUS_LISTENER(widget_layer_status, struct layer_status_state, layer_status_update_cb,
+                layer_status_get_state, QUEUE_LAYER)
 
 ZMK_SUBSCRIPTION(widget_layer_status, zmk_layer_state_changed);
 
 #ifdef CONFIG_RAW_HID
 
+#if STATUS_PAGE_STOCK || defined(NOWPLAY_WIDGET)
 static struct is_connected_notification get_is_hid_connected(const zmk_event_t *eh) {
     struct is_connected_notification *notification = as_is_connected_notification(eh);
     if (notification) {
@@ -344,18 +747,21 @@ static struct is_connected_notification get_is_hid_connected(const zmk_event_t *
     }
     return (struct is_connected_notification){.value = false};
 }
+#endif
+
+#if STATUS_PAGE_STOCK
 
 static void is_hid_connected_update_cb(struct is_connected_notification is_connected) {
     struct zmk_widget_status *widget;
     SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) {
         widget->state.is_connected = is_connected.value;
 
-        draw_hid(widget->obj, widget->cbuf_hid, &widget->state);
+        redraw(widget, UPDATE_HID);
     }
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_is_connected, struct is_connected_notification,
-                            is_hid_connected_update_cb, get_is_hid_connected)
+STATUS_LISTENER(widget_is_connected, struct is_connected_notification, is_hid_connected_update_cb,
+                get_is_hid_connected, QUEUE_HOST)
 ZMK_SUBSCRIPTION(widget_is_connected, is_connected_notification);
 
 static struct time_notification get_time(const zmk_event_t *eh) {
@@ -372,11 +778,11 @@ static void time_update_cb(struct time_notification time) {
         widget->state.hour = time.hour;
         widget->state.minute = time.minute;
 
-        draw_hid(widget->obj, widget->cbuf_hid, &widget->state);
+        redraw(widget, UPDATE_HID);
     }
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_time, struct time_notification, time_update_cb, get_time)
+STATUS_LISTENER(widget_time, struct time_notification, time_update_cb, get_time, QUEUE_TIME)
 ZMK_SUBSCRIPTION(widget_time, time_notification);
 
 static struct volume_notification get_volume(const zmk_event_t *eh) {
@@ -392,11 +798,12 @@ static void volume_update_cb(struct volume_notification volume) {
     SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) {
         widget->state.volume = volume.value;
 
-        draw_hid(widget->obj, widget->cbuf_hid, &widget->state);
+        redraw(widget, UPDATE_HID);
     }
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_volume, struct volume_notification, volume_update_cb, get_volume)
+STATUS_LISTENER(widget_volume, struct volume_notification, volume_update_cb, get_volume,
+                QUEUE_VOLUME)
 ZMK_SUBSCRIPTION(widget_volume, volume_notification);
 
 #ifdef CONFIG_NICE_VIEW_HID_SHOW_LAYOUT
@@ -414,16 +821,72 @@ static void layout_update_cb(struct layout_notification layout) {
     SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) {
         widget->state.layout = layout.value;
 
-        draw_hid(widget->obj, widget->cbuf_hid, &widget->state);
+        redraw(widget, UPDATE_HID);
     }
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_layout, struct layout_notification, layout_update_cb, get_layout)
+STATUS_LISTENER(widget_layout, struct layout_notification, layout_update_cb, get_layout,
+                QUEUE_LAYOUT)
 ZMK_SUBSCRIPTION(widget_layout, layout_notification);
 
-#endif
+#endif // CONFIG_NICE_VIEW_HID_SHOW_LAYOUT
+
+#ifdef CONFIG_NICE_VIEW_HID_SPARKLINE
+
+// samples received since the last redraw, the oldest are dropped once a whole graph is queued
+struct metric_samples {
+    uint8_t value[SPARKLINE_SAMPLES];
+    uint8_t count;
+};
+
+static bool add_metric(struct metric_samples *samples, const zmk_event_t *eh) {
+    struct metric_notification *metric = as_metric_notification(eh);
+    if (metric == NULL || metric->id != CONFIG_NICE_VIEW_HID_SPARKLINE_METRIC) {
+        return false;
+    }
 
-#if !defined(CONFIG_ZMK_SPLIT_ROLE_CENTRAL) && defined(CONFIG_NICE_VIEW_HID_MEDIA_INFO)
+    if (samples->count == SPARKLINE_SAMPLES) {
+        memmove(samples->value, &samples->value[1], SPARKLINE_SAMPLES - 1);
+        samples->count--;
+    }
+    samples->value[samples->count++] = metric->value;
+    return true;
+}
+
+static void metric_update_cb(struct metric_samples samples) {
+    if (samples.count == 0) {
+        return;
+    }
+
+    struct zmk_widget_status *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) {
+        for (int i = 0; i < samples.count; i++) {
+            widget->state.metric[widget->state.metric_head] = samples.value[i];
+            widget->state.metric_head = (widget->state.metric_head + 1) % SPARKLINE_SAMPLES;
+        }
+
+        // hidden pages redraw the whole graph when shown
+        if (widget->page != PAGE_STOCK) {
+            continue;
+        }
+        if (samples.count == 1) {
+            shift_sparkline(widget);
+        } else {
+            draw_sparkline(widget->cbuf[CANVAS_TOP], &widget->state);
+            lv_obj_invalidate(widget->canvas[CANVAS_TOP]);
+        }
+    }
+}
+
+STATUS_ACCUMULATOR(widget_metric, struct metric_samples, metric_update_cb, add_metric,
+                   QUEUE_METRIC)
+ZMK_SUBSCRIPTION(widget_metric, metric_notification);
+
+#endif // CONFIG_NICE_VIEW_HID_SPARKLINE
+
+#endif // STATUS_PAGE_STOCK
+
+#ifdef NOWPLAY_WIDGET
 static struct media_title_notification get_title_notif(const zmk_event_t *eh) {
     struct media_title_notification *ev = as_media_title_notification(eh);
     return ev ? *ev : (struct media_title_notification){ .title = "" };
@@ -431,15 +894,11 @@ static struct media_title_notification get_title_notif(const zmk_event_t *eh) {
 
 static void title_update_cb(struct media_title_notification notif) {
     struct zmk_widget_status *widget;
+    glyph_cache_account(notif.title);
     SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) {
         strncpy(widget->state.track_title, notif.title, sizeof(widget->state.track_title));
         widget->state.track_title[sizeof(widget->state.track_title)-1] = '\0';
-        if (widget->state.track_title[0] == '\0') {
-            lv_label_set_text(widget->label_track, "No media");
-            lv_label_set_text(widget->label_artist, "");
-        } else {
-            lv_label_set_text(widget->label_track, widget->state.track_title);
-        }
+        redraw(widget, UPDATE_MEDIA);
     }
 }
 
@@ -450,11 +909,12 @@ static struct media_artist_notification get_artist_notif(const zmk_event_t *eh)
 
 static void artist_update_cb(struct media_artist_notification notif) {
     struct zmk_widget_status *widget;
+    glyph_cache_account(notif.artist);
     SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) {
         if (widget->state.track_title[0] != '\0') {
             strncpy(widget->state.track_artist, notif.artist, sizeof(widget->state.track_artist));
             widget->state.track_artist[sizeof(widget->state.track_artist)-1] = '\0';
-            lv_label_set_text(widget->label_artist, widget->state.track_artist);
+            redraw(widget, UPDATE_MEDIA);
         }
     }
 }
@@ -465,103 +925,209 @@ static void media_conn_update_cb(struct is_connected_notification conn) {
         if (!conn.value) {
             widget->state.track_title[0] = '\0';
             widget->state.track_artist[0] = '\0';
-            lv_label_set_text(widget->label_track, "No media");
-            lv_label_set_text(widget->label_artist, "");
+#ifdef CONFIG_NICE_VIEW_HID_TILES
+            widget->state.art_visible = false;
+#endif
+            redraw(widget, UPDATE_MEDIA | UPDATE_ART);
         }
     }
 }
 
+#ifdef CONFIG_NICE_VIEW_HID_TILES
+static struct image_notification get_image_notif(const zmk_event_t *eh) {
+    struct image_notification *ev = as_image_notification(eh);
+    return ev ? *ev : (struct image_notification){ .visible = false };
+}
+
+static void image_update_cb(struct image_notification notif) {
+    struct zmk_widget_status *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) {
+        widget->state.art_visible = notif.visible;
+        widget->state.art_id = notif.id;
+
+        redraw(widget, UPDATE_ART);
+    }
+}
+#endif
+
 // Register listeners
-ZMK_DISPLAY_WIDGET_LISTENER(widget_media_title, struct media_title_notification,
-                             title_update_cb, get_title_notif)
+STATUS_LISTENER(widget_media_title, struct media_title_notification, title_update_cb,
+                get_title_notif, QUEUE_TITLE)
 ZMK_SUBSCRIPTION(widget_media_title, media_title_notification);
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_media_artist, struct media_artist_notification,
-                             artist_update_cb, get_artist_notif)
+STATUS_LISTENER(widget_media_artist, struct media_artist_notification, artist_update_cb,
+                get_artist_notif, QUEUE_ARTIST)
 ZMK_SUBSCRIPTION(widget_media_artist, media_artist_notification);
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_media_conn, struct is_connected_notification,
-                             media_conn_update_cb, get_is_hid_connected)
+STATUS_LISTENER(widget_media_conn, struct is_connected_notification, media_conn_update_cb,
+                get_is_hid_connected, QUEUE_MEDIA_HOST)
 ZMK_SUBSCRIPTION(widget_media_conn, is_connected_notification);
-#endif // peripheral media widget
 
-#endif // CONFIG_RAW_HID
+#ifdef CONFIG_NICE_VIEW_HID_TILES
+STATUS_LISTENER(widget_media_art, struct image_notification, image_update_cb, get_image_notif,
+                QUEUE_ART)
+ZMK_SUBSCRIPTION(widget_media_art, image_notification);
+#endif
+#endif // NOWPLAY_WIDGET
 
-#endif // !defined(CONFIG_NICE_VIEW_HID_MEDIA_INFO)
+#ifdef CONFIG_NICE_VIEW_HID_GLYPHS
+static struct glyph_notification get_glyph_notif(const zmk_event_t *eh) {
+    struct glyph_notification *ev = as_glyph_notification(eh);
+    return ev ? *ev : (struct glyph_notification){.codepoint = 0};
+}
 
-int zmk_widget_status_init(struct zmk_widget_status *widget, lv_obj_t *parent) {
-    widget->obj = lv_obj_create(parent);
-    lv_obj_set_size(widget->obj, 160, 68);
+static void glyph_update_cb(struct glyph_notification notif) {
+    struct zmk_widget_status *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { redraw(widget, UPDATE_TEXT); }
+}
 
-    lv_obj_t *top = lv_canvas_create(widget->obj);
-    lv_obj_align(top, LV_ALIGN_TOP_RIGHT, 0, 0);
-    lv_canvas_set_buffer(top, widget->cbuf, CANVAS_SIZE, CANVAS_SIZE, LV_IMG_CF_TRUE_COLOR);
+STATUS_LISTENER(widget_glyphs, struct glyph_notification, glyph_update_cb, get_glyph_notif,
+                QUEUE_GLYPHS)
+ZMK_SUBSCRIPTION(widget_glyphs, glyph_notification);
+#endif
 
-    lv_obj_t *hid = lv_canvas_create(widget->obj);
-    lv_obj_align(hid, LV_ALIGN_TOP_LEFT, 64, 0);
-    lv_canvas_set_buffer(hid, widget->cbuf_hid, CANVAS_SIZE, CANVAS_SIZE, LV_IMG_CF_TRUE_COLOR);
+#endif // CONFIG_RAW_HID
 
-    lv_obj_t *middle = lv_canvas_create(widget->obj);
-    lv_obj_align(middle, LV_ALIGN_TOP_LEFT, -4, 0);
-    lv_canvas_set_buffer(middle, widget->cbuf2, CANVAS_SIZE, CANVAS_SIZE, LV_IMG_CF_TRUE_COLOR);
+#ifdef CONFIG_NICE_VIEW_HID_PAGES
+// steps taken before the screen catches up are added up, so quick presses aren't lost
+static bool add_page_step(struct page_notification *pending, const zmk_event_t *eh) {
+    struct page_notification *ev = as_page_notification(eh);
+    if (ev == NULL) {
+        return false;
+    }
 
-    lv_obj_t *bottom = lv_canvas_create(widget->obj);
-    lv_obj_align(bottom, LV_ALIGN_TOP_LEFT, -44, 0);
-    lv_canvas_set_buffer(bottom, widget->cbuf3, CANVAS_SIZE, CANVAS_SIZE, LV_IMG_CF_TRUE_COLOR);
+    pending->step = (pending->step + ev->step % PAGE_COUNT) % PAGE_COUNT;
+    return true;
+}
 
-    // Ensure state is zero-initialized (no stale data)
-    memset(&widget->state, 0, sizeof(widget->state));
+static void page_update_cb(struct page_notification notif) {
+    if (notif.step == 0) {
+        return;
+    }
 
-#if !defined(CONFIG_NICE_VIEW_HID_MEDIA_INFO)
-    // Only register the old listeners when not in media-info mode
-    widget_battery_status_init();
-    widget_output_status_init();
-    widget_layer_status_init();
-#ifdef CONFIG_RAW_HID
-    widget_is_connected_init();
-    widget_time_init();
-    widget_volume_init();
+    struct zmk_widget_status *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) {
+        show_page(widget, (widget->page + PAGE_COUNT + notif.step % PAGE_COUNT) % PAGE_COUNT);
+    }
+}
+
+STATUS_ACCUMULATOR(widget_page, struct page_notification, page_update_cb, add_page_step,
+                   QUEUE_PAGE)
+ZMK_SUBSCRIPTION(widget_page, page_notification);
+#endif
+
+static void (*const queue_handlers[QUEUE_COUNT])(void) = {
+    [QUEUE_BATTERY] = widget_battery_status_apply,
+    [QUEUE_LAYER] = widget_layer_status_apply,
+    [QUEUE_OUTPUT] = widget_output_status_apply,
+#ifdef CONFIG_NICE_VIEW_HID_PAGES
+    [QUEUE_PAGE] = widget_page_apply,
+#endif
+#if defined(CONFIG_RAW_HID) && STATUS_PAGE_STOCK
+    [QUEUE_HOST] = widget_is_connected_apply,
+    [QUEUE_TIME] = widget_time_apply,
+    [QUEUE_VOLUME] = widget_volume_apply,
 #ifdef CONFIG_NICE_VIEW_HID_SHOW_LAYOUT
-    widget_layout_init();
+    [QUEUE_LAYOUT] = widget_layout_apply,
+#endif
+#ifdef CONFIG_NICE_VIEW_HID_SPARKLINE
+    [QUEUE_METRIC] = widget_metric_apply,
 #endif
-#endif // !CONFIG_NICE_VIEW_HID_MEDIA_INFO
+#endif
+#ifdef NOWPLAY_WIDGET
+    [QUEUE_TITLE] = widget_media_title_apply,
+    [QUEUE_ARTIST] = widget_media_artist_apply,
+    [QUEUE_MEDIA_HOST] = widget_media_conn_apply,
+#ifdef CONFIG_NICE_VIEW_HID_TILES
+    [QUEUE_ART] = widget_media_art_apply,
+#endif
+#endif
+#ifdef CONFIG_NICE_VIEW_HID_GLYPHS
+    [QUEUE_GLYPHS] = widget_glyphs_apply,
+#endif
+};
 
-#if defined(CONFIG_NICE_VIEW_HID_MEDIA_INFO)
-    // Now Playing header
-    widget->label_now = lv_label_create(widget->obj);
-    lv_obj_set_style_text_font(widget->label_now, &lv_font_montserrat_12, 0);
-    lv_label_set_text_static(widget->label_now, "Now Playing");
-    lv_obj_set_pos(widget->label_now, 0, NOWPLAY_Y_OFFSET);
+static void queue_work_cb(struct k_work *work) {
+    // cleared before applying, so a report arriving meanwhile is queued again
+    uint32_t take = update_queue_take(atomic_get(&queue_pending), QUEUE_FIRST_HOST);
+    atomic_and(&queue_pending, ~take);
 
-    // Track title (scrolling)
-    widget->label_track = lv_label_create(widget->obj);
-    lv_obj_set_width(widget->label_track, 160);
-    lv_obj_set_style_text_font(widget->label_track, &lv_font_montserrat_18, 0);
-    lv_label_set_long_mode(widget->label_track, LV_LABEL_LONG_SCROLL_CIRCULAR);
-    lv_obj_set_style_anim_speed(widget->label_track, NOWPLAY_SCROLL_SPEED, 0);
-    lv_label_set_text(widget->label_track, "No media");
-    lv_obj_set_pos(widget->label_track, 0, NOWPLAY_Y_OFFSET + 12 + 4);
+    for (int category = 0; category < QUEUE_COUNT; category++) {
+        if (!(take & BIT(category))) {
+            continue;
+        }
 
-    // Artist name
-    widget->label_artist = lv_label_create(widget->obj);
-    lv_obj_set_width(widget->label_artist, 160);
-    lv_obj_set_style_text_font(widget->label_artist, &lv_font_montserrat_12, 0);
-    lv_label_set_long_mode(widget->label_artist, LV_LABEL_LONG_DOT);
-    lv_label_set_text(widget->label_artist, "");
-    lv_obj_set_pos(widget->label_artist, 0, NOWPLAY_Y_OFFSET + 12 + 4 + 18 + 2);
+        if (category < QUEUE_FIRST_HOST) {
+            int64_t latency = k_uptime_get() - queued_at[category];
+            if (latency > max_keyboard_latency) {
+                max_keyboard_latency = latency;
+                LOG_DBG("keyboard state update latency max %lld ms", (long long)latency);
+            }
+        }
+
+        if (queue_handlers[category] != NULL) {
+            queue_handlers[category]();
+        }
+    }
 
-    // Register your media listeners
-    widget_media_title_init();
-    widget_media_artist_init();
-    widget_media_conn_init();
+    uint32_t pending = atomic_get(&queue_pending);
+    if (pending != 0) {
+        k_work_submit_to_queue(zmk_display_work_q(), &queue_work);
+    }
+
+#ifdef CONFIG_NICE_VIEW_HID_FLOW_CONTROL
+    // the host is told to back off while its updates pile up here
+    flow_control_backlog(update_queue_host_pending(pending, QUEUE_FIRST_HOST));
 #endif
+}
+
+// Listeners compiled in for the widgets above, started once the widget is registered
+static void (*const status_listeners[])(void) = {
+    widget_battery_status_init,
+    widget_output_status_init,
+    widget_layer_status_init,
+#if defined(CONFIG_RAW_HID) && STATUS_PAGE_STOCK
+    widget_is_connected_init,
+    widget_time_init,
+    widget_volume_init,
+#ifdef CONFIG_NICE_VIEW_HID_SHOW_LAYOUT
+    widget_layout_init,
+#endif
+#ifdef CONFIG_NICE_VIEW_HID_SPARKLINE
+    widget_metric_init,
+#endif
+#endif
+#ifdef NOWPLAY_WIDGET
+    widget_media_title_init,
+    widget_media_artist_init,
+    widget_media_conn_init,
+#ifdef CONFIG_NICE_VIEW_HID_TILES
+    widget_media_art_init,
+#endif
+#endif
+#ifdef CONFIG_NICE_VIEW_HID_GLYPHS
+    widget_glyphs_init,
+#endif
+#ifdef CONFIG_NICE_VIEW_HID_PAGES
+    widget_page_init,
+#endif
+};
+
+int zmk_widget_status_init(struct zmk_widget_status *widget, lv_obj_t *parent) {
+    widget->obj = lv_obj_create(parent);
+    lv_obj_set_size(widget->obj, 160, 68);
+
+    // Ensure state is zero-initialized (no stale data)
+    memset(&widget->state, 0, sizeof(widget->state));
+
+    widget->page_obj = NULL;
+    show_page(widget, 0);
 
     sys_slist_append(&widgets, &widget->node);
 
-#if !defined(CONFIG_NICE_VIEW_HID_MEDIA_INFO)
-    // Draw the normal widgets on init if not in media mode
-    draw_hid(widget->obj, widget->cbuf_hid, &widget->state);
-#endif
+    for (int i = 0; i < ARRAY_SIZE(status_listeners); i++) {
+        status_listeners[i]();
+    }
 
     return 0;
 }
@@ -11,18 +11,61 @@
 #include <zephyr/kernel.h>
 #include "util.h"
 
+// The stock widgets and media info each fill a page of their own. Without
+// CONFIG_NICE_VIEW_HID_PAGES only one of them is built.
+#define STATUS_PAGE_STOCK                                                                          \
+    (!IS_ENABLED(CONFIG_NICE_VIEW_HID_MEDIA_INFO) || IS_ENABLED(CONFIG_NICE_VIEW_HID_PAGES))
+#define STATUS_PAGE_MEDIA IS_ENABLED(CONFIG_NICE_VIEW_HID_MEDIA_INFO)
+
+// battery, output, profile and layer on the media page
+#define STATUS_TEXT_SIZE 48
+
+enum status_page {
+#if STATUS_PAGE_STOCK
+    PAGE_STOCK,
+#endif
+#if STATUS_PAGE_MEDIA
+    PAGE_MEDIA,
+#endif
+    PAGE_COUNT,
+};
+
+// media info is built from labels only, so only the stock page needs canvas buffers
+#if STATUS_PAGE_STOCK
+enum status_canvas {
+    CANVAS_TOP = 0,
+    CANVAS_HID,
+    CANVAS_MIDDLE,
+    CANVAS_BOTTOM,
+};
+#define STATUS_CANVAS_COUNT 4
+#else
+#define STATUS_CANVAS_COUNT 0
+#endif
+
 struct zmk_widget_status {
     sys_snode_t node;
     lv_obj_t *obj;
-    lv_color_t cbuf[CANVAS_SIZE * CANVAS_SIZE];
-    lv_color_t cbuf_hid[CANVAS_SIZE * CANVAS_SIZE];
-    lv_color_t cbuf2[CANVAS_SIZE * CANVAS_SIZE];
-    lv_color_t cbuf3[CANVAS_SIZE * CANVAS_SIZE];
+    // objects of the visible page, deleted and rebuilt when switching pages
+    lv_obj_t *page_obj;
+    uint8_t page;
+#if STATUS_CANVAS_COUNT > 0
+    lv_obj_t *canvas[STATUS_CANVAS_COUNT];
+    // stock page canvases, the only page that draws to canvases
+    lv_color_t cbuf[STATUS_CANVAS_COUNT][CANVAS_SIZE * CANVAS_SIZE];
+#endif
     struct status_state state;
-#if IS_ENABLED(CONFIG_NICE_VIEW_HID_MEDIA_INFO)
+#if STATUS_PAGE_MEDIA
+    lv_obj_t *label_status;
+#ifdef CONFIG_NICE_VIEW_HID_STATIC_TEXT
+    char text_status[STATUS_TEXT_SIZE];
+#endif
     lv_obj_t *label_now;
     lv_obj_t *label_track;
     lv_obj_t *label_artist;
+#ifdef CONFIG_NICE_VIEW_HID_TILES
+    lv_obj_t *img_art;
+#endif
 #endif
 };
 
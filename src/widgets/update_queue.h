@@ -0,0 +1,53 @@
+/*
+ *
+ * Copyright (c) 2023 The ZMK Contributors
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Scheduling of the status screen update queue, one bit per category in a pending mask.
+// Categories below first_host are keyboard state, the rest come from the host. Plain C, so the
+// ordering can be tested on the host.
+
+enum status_queue {
+    // keyboard state
+    QUEUE_BATTERY,
+    QUEUE_LAYER,
+    QUEUE_OUTPUT,
+    QUEUE_PAGE,
+    // host info
+    QUEUE_HOST,
+    QUEUE_TIME,
+    QUEUE_LAYOUT,
+    QUEUE_VOLUME,
+    QUEUE_METRIC,
+    QUEUE_TITLE,
+    QUEUE_ARTIST,
+    // after the media it clears, so a disconnect isn't undone by an older title
+    QUEUE_MEDIA_HOST,
+    QUEUE_ART,
+    QUEUE_GLYPHS,
+    QUEUE_COUNT,
+};
+
+#define QUEUE_FIRST_HOST QUEUE_HOST
+
+// Categories the next pass applies, in bit order: every pending keyboard category, then at
+// most the first pending host category. A keyboard update therefore waits for at most one
+// host redraw, however many host categories are pending.
+static inline uint32_t update_queue_take(uint32_t pending, uint8_t first_host) {
+    uint32_t keyboard = pending & ((1u << first_host) - 1);
+    uint32_t host = pending & ~((1u << first_host) - 1);
+
+    // lowest set bit
+    return keyboard | (host & (~host + 1));
+}
+
+// number of host categories in a pending mask
+static inline uint8_t update_queue_host_pending(uint32_t pending, uint8_t first_host) {
+    return __builtin_popcount(pending >> first_host);
+}
@@ -8,7 +8,7 @@
 #include <lvgl.h>
 #include <zmk/endpoints.h>
 
-#define CANVAS_SIZE 68
+#include "canvas.h"
 
 #define LVGL_BACKGROUND                                                                            \
     IS_ENABLED(CONFIG_NICE_VIEW_HID_INVERTED) ? lv_color_black() : lv_color_white()
@@ -33,9 +33,24 @@ struct status_state {
     uint8_t layout;
     char track_title[32];
     char track_artist[32];
+#ifdef CONFIG_NICE_VIEW_HID_TILES
+    bool art_visible;
+    uint16_t art_id;
+#endif
+#ifdef CONFIG_NICE_VIEW_HID_SPARKLINE
+    uint8_t metric[SPARKLINE_SAMPLES];
+    uint8_t metric_head;
+#endif
 #endif
 #else
     bool connected;
+#ifdef CONFIG_NICE_VIEW_HID_SPLIT_RELAY
+    bool host_connected;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t volume;
+    bool playing;
+#endif
 #endif
 };
 
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2023 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// Loopback test of the split relay codec: frames are built the way the central's flush builds
+// them and decoded the way the peripheral does, then compared with what was sent.
+
+#include <nice_view_hid/relay_frame.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures;
+
+#define CHECK(cond)                                                                                \
+    do {                                                                                           \
+        if (!(cond)) {                                                                             \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);               \
+            failures++;                                                                            \
+        }                                                                                          \
+    } while (0)
+
+static void set_string(char dst[RELAY_STR_LEN], const char *src) {
+    memset(dst, 0, RELAY_STR_LEN);
+    strncpy(dst, src, RELAY_STR_LEN - 1);
+}
+
+// sends every needed chunk of str to the receiver and returns the number of frames
+static int relay_string(enum relay_frame_kind kind, const char *str, char sent[RELAY_STR_LEN],
+                        char received[RELAY_STR_LEN], int *completed) {
+    int frames = 0;
+
+    for (uint8_t chunk = 0; chunk <= relay_last_chunk(str); chunk++) {
+        if (!relay_chunk_needed(str, sent, chunk)) {
+            continue;
+        }
+
+        uint8_t frame[RELAY_FRAME_SIZE];
+        relay_encode_chunk(frame, kind, str, chunk);
+        CHECK(RELAY_HEADER_KIND(frame[0]) == kind);
+        if (relay_decode_chunk(received, frame)) {
+            (*completed)++;
+        }
+        frames++;
+    }
+
+    memcpy(sent, str, RELAY_STR_LEN);
+    return frames;
+}
+
+static void test_scalars(void) {
+    struct relay_state state = {
+        .is_connected = true, .hour = 23, .minute = 59, .volume = 100, .layout = 3};
+
+    for (uint8_t mask = 0; mask <= RELAY_ALL_SCALARS; mask++) {
+        struct relay_state received = {0};
+        uint8_t frame[RELAY_FRAME_SIZE];
+
+        relay_encode_scalars(frame, &state, mask);
+        CHECK(RELAY_HEADER_KIND(frame[0]) == RELAY_SCALARS);
+        CHECK(relay_decode_scalars(frame, &received) == mask);
+        CHECK(relay_changed_scalars(&state, &received) == (RELAY_ALL_SCALARS & ~mask));
+    }
+}
+
+static void test_changed_scalars(void) {
+    struct relay_state a = {0};
+    struct relay_state b = {0};
+
+    CHECK(relay_changed_scalars(&a, &b) == 0);
+    b.minute = 1;
+    CHECK(relay_changed_scalars(&a, &b) == RELAY_TIME);
+    b.volume = 50;
+    CHECK(relay_changed_scalars(&a, &b) == (RELAY_TIME | RELAY_VOLUME));
+}
+
+static void test_strings(void) {
+    static const char *const titles[] = {
+        "", "a", "exactly6", "Title of a song", "Title of a song, longer now", "Title of a",
+        "This one is far too long to fit in the relay buffer",
+    };
+    char sent[RELAY_STR_LEN];
+    char received[RELAY_STR_LEN];
+
+    // a fresh peripheral gets every chunk
+    memset(sent, 0xFF, RELAY_STR_LEN);
+    memset(received, 0, RELAY_STR_LEN);
+
+    for (size_t i = 0; i < sizeof(titles) / sizeof(titles[0]); i++) {
+        char title[RELAY_STR_LEN];
+        int completed = 0;
+
+        set_string(title, titles[i]);
+        int frames = relay_string(RELAY_TITLE, title, sent, received, &completed);
+
+        CHECK(completed == 1);
+        CHECK(frames <= relay_last_chunk(title) + 1);
+        CHECK(strcmp(received, title) == 0);
+    }
+}
+
+static void test_delta(void) {
+    char sent[RELAY_STR_LEN];
+    char received[RELAY_STR_LEN];
+    char title[RELAY_STR_LEN];
+    int completed = 0;
+
+    memset(sent, 0xFF, RELAY_STR_LEN);
+    set_string(title, "Same start, other end");
+    relay_string(RELAY_TITLE, title, sent, received, &completed);
+
+    // only the chunks that changed and the terminating one go out again
+    set_string(title, "Same start, new end!!");
+    CHECK(relay_string(RELAY_TITLE, title, sent, received, &completed) == 2);
+    CHECK(strcmp(received, title) == 0);
+
+    // an unchanged string still resends its last chunk
+    CHECK(relay_string(RELAY_TITLE, title, sent, received, &completed) == 1);
+    CHECK(completed == 3);
+}
+
+static void test_bad_chunk(void) {
+    char received[RELAY_STR_LEN] = "untouched";
+    uint8_t frame[RELAY_FRAME_SIZE] = {RELAY_HEADER(RELAY_ARTIST, 31), 5, 'x'};
+
+    CHECK(!relay_decode_chunk(received, frame));
+    CHECK(strcmp(received, "untouched") == 0);
+}
+
+int main(void) {
+    test_scalars();
+    test_changed_scalars();
+    test_strings();
+    test_delta();
+    test_bad_chunk();
+
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("relay frame tests passed\n");
+    return EXIT_SUCCESS;
+}
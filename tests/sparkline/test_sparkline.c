@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2023 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// Checks where the sparkline lands in the rotated top canvas. rotate_canvas() is modelled with
+// the integer math of LVGL 8's lv_canvas_transform() for a 90 degree turn around the
+// CANVAS_SIZE / 2 pivot with an x offset of -1, and every upright pixel is followed into the
+// rotated buffer.
+
+#include "canvas.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures;
+
+#define CHECK(cond)                                                                                \
+    do {                                                                                           \
+        if (!(cond)) {                                                                             \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);               \
+            failures++;                                                                            \
+        }                                                                                          \
+    } while (0)
+
+#define PIXELS (CANVAS_SIZE * CANVAS_SIZE)
+#define NOT_WRITTEN UINT16_MAX
+
+// lv_trigo_sin() values for the angles _lv_img_buf_transform_init() looks up at 90 degrees
+#define LV_TRIGO_SHIFT 15
+#define LV_TRANSFORM_TRIGO_SHIFT 10
+#define SIN_MINUS_90 (-32767)
+#define SIN_0 0
+
+// rotate_canvas(): lv_canvas_transform(canvas, &img, 900, LV_IMG_ZOOM_NONE, -1, 0,
+// CANVAS_SIZE / 2, CANVAS_SIZE / 2, true)
+static void rotate(const uint16_t src[PIXELS], uint16_t dst[PIXELS]) {
+    const int32_t offset_x = -1;
+    const int32_t offset_y = 0;
+    const int32_t pivot = CANVAS_SIZE / 2;
+    const int32_t sinma = SIN_MINUS_90 >> (LV_TRIGO_SHIFT - LV_TRANSFORM_TRIGO_SHIFT);
+    const int32_t cosma = SIN_0 >> (LV_TRIGO_SHIFT - LV_TRANSFORM_TRIGO_SHIFT);
+    const int32_t shift = LV_TRANSFORM_TRIGO_SHIFT - 8;
+
+    for (int i = 0; i < PIXELS; i++) {
+        dst[i] = NOT_WRITTEN;
+    }
+
+    for (int32_t y = -offset_y; y < CANVAS_SIZE - offset_y; y++) {
+        for (int32_t x = -offset_x; x < CANVAS_SIZE - offset_x; x++) {
+            int32_t xt = x - pivot;
+            int32_t yt = y - pivot;
+            int32_t xs = ((cosma * xt - sinma * yt) >> shift) + pivot * 256;
+            int32_t ys = ((sinma * xt + cosma * yt) >> shift) + pivot * 256;
+            int32_t xs_int = xs >> 8;
+            int32_t ys_int = ys >> 8;
+
+            if (xs_int < 0 || xs_int >= CANVAS_SIZE || ys_int < 0 || ys_int >= CANVAS_SIZE) {
+                continue;
+            }
+            dst[(y + offset_y) * CANVAS_SIZE + x + offset_x] = src[ys_int * CANVAS_SIZE + xs_int];
+        }
+    }
+}
+
+static uint16_t upright_id(int x, int y) { return y * CANVAS_SIZE + x; }
+
+static void test_rotated_index(void) {
+    static uint16_t upright[PIXELS];
+    static uint16_t rotated[PIXELS];
+
+    for (int y = 0; y < CANVAS_SIZE; y++) {
+        for (int x = 0; x < CANVAS_SIZE; x++) {
+            upright[y * CANVAS_SIZE + x] = upright_id(x, y);
+        }
+    }
+    rotate(upright, rotated);
+
+    for (int y = 0; y < CANVAS_SIZE; y++) {
+        for (int x = 0; x < CANVAS_SIZE; x++) {
+            CHECK(rotated[CANVAS_ROTATED_INDEX(x, y)] == upright_id(x, y));
+        }
+    }
+}
+
+static void test_sparkline_columns(void) {
+    static uint16_t upright[PIXELS];
+    static uint16_t rotated[PIXELS];
+
+    // the graph fits inside the frame's border
+    CHECK(SPARKLINE_X >= 1);
+    CHECK(SPARKLINE_X + SPARKLINE_SAMPLES <= CANVAS_SIZE - 1);
+    CHECK(SPARKLINE_Y >= SPARKLINE_FRAME_Y + 1);
+    CHECK(SPARKLINE_Y + SPARKLINE_H <= SPARKLINE_FRAME_Y + SPARKLINE_FRAME_H - 1);
+
+    // draw sample x as a bar of x + 1 pixels upright, then look it up in the rotated buffer
+    memset(upright, 0, sizeof(upright));
+    for (int x = 0; x < SPARKLINE_SAMPLES; x++) {
+        int height = (x + 1) % (SPARKLINE_H + 1);
+        for (int y = 0; y < height; y++) {
+            upright[(SPARKLINE_Y + SPARKLINE_H - 1 - y) * CANVAS_SIZE + SPARKLINE_X + x] = x + 1;
+        }
+    }
+    rotate(upright, rotated);
+
+    for (int x = 0; x < SPARKLINE_SAMPLES; x++) {
+        int height = (x + 1) % (SPARKLINE_H + 1);
+        // column[0] is the bottom, and a column never wraps into the next buffer row
+        CHECK(SPARKLINE_COLUMN(x) / CANVAS_SIZE == (SPARKLINE_COLUMN(x) + SPARKLINE_H - 1) /
+                                                      CANVAS_SIZE);
+        for (int y = 0; y < SPARKLINE_H; y++) {
+            CHECK(rotated[SPARKLINE_COLUMN(x) + y] == (y < height ? x + 1 : 0));
+        }
+    }
+
+    // the newest sample is the rightmost column of the graph
+    CHECK(rotated[SPARKLINE_COLUMN(SPARKLINE_SAMPLES - 1)] == SPARKLINE_SAMPLES);
+    CHECK(SPARKLINE_COLUMN(SPARKLINE_SAMPLES - 1) ==
+          CANVAS_ROTATED_INDEX(SPARKLINE_X + SPARKLINE_SAMPLES - 1, SPARKLINE_Y + SPARKLINE_H - 1));
+}
+
+int main(void) {
+    test_rotated_index();
+    test_sparkline_columns();
+
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("sparkline tests passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2023 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// Replays a host report storm against the status screen update queue and checks that keyboard
+// state changes are never delayed by more than one host redraw.
+
+#include "update_queue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define HOST_MASK (((1u << QUEUE_COUNT) - 1) & ~((1u << QUEUE_FIRST_HOST) - 1))
+
+static int failures;
+
+#define CHECK(cond)                                                                                \
+    do {                                                                                           \
+        if (!(cond)) {                                                                             \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);               \
+            failures++;                                                                            \
+        }                                                                                          \
+    } while (0)
+
+struct queue_sim {
+    uint32_t pending;
+    // host redraws done so far, and the count when each keyboard category was queued
+    uint32_t host_redraws;
+    uint32_t queued_at[QUEUE_FIRST_HOST];
+    uint32_t worst_wait;
+    uint32_t keyboard_applied;
+};
+
+static void sim_queue(struct queue_sim *sim, int category) {
+    if (!(sim->pending & (1u << category)) && category < QUEUE_FIRST_HOST) {
+        sim->queued_at[category] = sim->host_redraws;
+    }
+    sim->pending |= 1u << category;
+}
+
+// one run of queue_work_cb, calling storm() while each host category redraws
+static void sim_pass(struct queue_sim *sim, void (*storm)(struct queue_sim *sim)) {
+    uint32_t take = update_queue_take(sim->pending, QUEUE_FIRST_HOST);
+    sim->pending &= ~take;
+
+    CHECK(update_queue_host_pending(take, QUEUE_FIRST_HOST) <= 1);
+
+    for (int category = 0; category < QUEUE_COUNT; category++) {
+        if (!(take & (1u << category))) {
+            continue;
+        }
+
+        if (category < QUEUE_FIRST_HOST) {
+            uint32_t wait = sim->host_redraws - sim->queued_at[category];
+            if (wait > sim->worst_wait) {
+                sim->worst_wait = wait;
+            }
+            sim->keyboard_applied++;
+        } else {
+            // reports arriving during this redraw wait for it to finish
+            if (storm != NULL) {
+                storm(sim);
+            }
+            sim->host_redraws++;
+        }
+    }
+}
+
+// every host category is re-queued during every host redraw, and now and then a key changes the
+// layer or the battery reports
+static void full_storm(struct queue_sim *sim) {
+    sim->pending |= HOST_MASK;
+    if (rand() % 3 == 0) {
+        sim_queue(sim, rand() % QUEUE_FIRST_HOST);
+    }
+}
+
+static void test_storm(void) {
+    struct queue_sim sim = {.pending = HOST_MASK};
+
+    srand(1);
+    for (int pass = 0; pass < 100000; pass++) {
+        sim_pass(&sim, full_storm);
+    }
+
+    printf("storm: %u host redraws, %u keyboard updates, worst wait %u host redraws\n",
+           sim.host_redraws, sim.keyboard_applied, sim.worst_wait);
+    CHECK(sim.keyboard_applied > 0);
+    CHECK(sim.worst_wait <= 1);
+}
+
+static void test_keyboard_first(void) {
+    struct queue_sim sim = {0};
+
+    sim.pending = HOST_MASK;
+    sim_queue(&sim, QUEUE_LAYER);
+    sim_queue(&sim, QUEUE_BATTERY);
+
+    uint32_t take = update_queue_take(sim.pending, QUEUE_FIRST_HOST);
+    CHECK(take == ((1u << QUEUE_BATTERY) | (1u << QUEUE_LAYER) | (1u << QUEUE_HOST)));
+}
+
+static void test_media_order(void) {
+    // a disconnect queued with an older title is applied after it
+    uint32_t pending = (1u << QUEUE_MEDIA_HOST) | (1u << QUEUE_TITLE);
+
+    CHECK(update_queue_take(pending, QUEUE_FIRST_HOST) == (1u << QUEUE_TITLE));
+    pending &= ~(1u << QUEUE_TITLE);
+    CHECK(update_queue_take(pending, QUEUE_FIRST_HOST) == (1u << QUEUE_MEDIA_HOST));
+}
+
+static void test_drains(void) {
+    struct queue_sim sim = {.pending = (1u << QUEUE_COUNT) - 1};
+    int passes = 0;
+
+    while (sim.pending != 0 && passes < QUEUE_COUNT) {
+        sim_pass(&sim, NULL);
+        passes++;
+    }
+
+    // once the storm stops, every host category gets one pass
+    CHECK(sim.pending == 0);
+    CHECK(passes == QUEUE_COUNT - QUEUE_FIRST_HOST);
+    CHECK(update_queue_host_pending(HOST_MASK, QUEUE_FIRST_HOST) ==
+          QUEUE_COUNT - QUEUE_FIRST_HOST);
+}
+
+int main(void) {
+    test_storm();
+    test_keyboard_first();
+    test_media_order();
+    test_drains();
+
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("update queue tests passed\n");
+    return EXIT_SUCCESS;
+}